@@ -7,11 +7,8 @@ Agent::Agent(std::string name, std::string model_path, std::shared_ptr<Settings>
 {
     LDEBUG << "Creating agent '" << m_Name << "'";
 
-    // load the weights
+    // load the weights, which also moves them to the configured device
     m_NN->loadModel(model_path);
-    if (settings->useCUDA()) {
-        m_NN->getNetwork()->to(torch::kCUDA);
-    }
 }
 
 Agent::Agent(std::string name, std::shared_ptr<NeuralNetwork> nn, std::shared_ptr<Settings> settings)
@@ -0,0 +1,165 @@
+#include "batchEvaluator.hpp"
+
+SimulationTask::SimulationTask(std::coroutine_handle<promise_type> handle)
+  : m_Handle(handle)
+{
+}
+
+SimulationTask::SimulationTask(SimulationTask && other) noexcept
+  : m_Handle(std::exchange(other.m_Handle, nullptr))
+{
+}
+
+SimulationTask & SimulationTask::operator=(SimulationTask && other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_Handle)
+        {
+            m_Handle.destroy();
+        }
+        m_Handle = std::exchange(other.m_Handle, nullptr);
+    }
+    return *this;
+}
+
+SimulationTask::~SimulationTask()
+{
+    if (m_Handle)
+    {
+        m_Handle.destroy();
+    }
+}
+
+bool SimulationTask::done() const
+{
+    return !m_Handle || m_Handle.done();
+}
+
+BatchEvaluator::BatchEvaluator(std::shared_ptr<NeuralNetwork> nn, int batchSize, std::chrono::microseconds timeout)
+  : m_NN(nn)
+  , m_BatchSize(std::max(1, batchSize))
+  , m_Timeout(timeout)
+{
+}
+
+BatchEvaluator::~BatchEvaluator()
+{
+    if (!m_Queue.empty())
+    {
+        LWARN << "Destroying BatchEvaluator with " << m_Queue.size() << " positions still waiting";
+    }
+}
+
+BatchEvaluator::Awaiter BatchEvaluator::evaluate(torch::Tensor input)
+{
+    return Awaiter{*this, std::move(input), Evaluation()};
+}
+
+void BatchEvaluator::enqueue(Awaiter * awaiter, std::coroutine_handle<> handle)
+{
+    if (m_Queue.empty())
+    {
+        m_OldestRequest = std::chrono::steady_clock::now();
+    }
+    m_Queue.emplace_back(awaiter, handle);
+}
+
+void BatchEvaluator::speculate(Node * node, torch::Tensor input)
+{
+    m_Speculative.emplace_back(node, std::move(input));
+}
+
+void BatchEvaluator::clearSpeculative()
+{
+    m_Speculative.clear();
+}
+
+void BatchEvaluator::recordSpeculativeHit()
+{
+    m_SpeculativeHits++;
+}
+
+void BatchEvaluator::recordCollision()
+{
+    m_Collisions++;
+}
+
+bool BatchEvaluator::shouldFlush() const
+{
+    if (m_Queue.empty())
+    {
+        return false;
+    }
+    return (int)m_Queue.size() >= m_BatchSize || std::chrono::steady_clock::now() - m_OldestRequest >= m_Timeout;
+}
+
+void BatchEvaluator::flush()
+{
+    if (m_Queue.empty())
+    {
+        return;
+    }
+    // resumed simulations may queue new positions, so take the current batch out first
+    std::vector<std::pair<Awaiter *, std::coroutine_handle<>>> batch;
+    batch.swap(m_Queue);
+
+    std::vector<torch::Tensor> inputs;
+    for (auto const & [awaiter, handle]: batch)
+    {
+        inputs.push_back(awaiter->input);
+    }
+
+    // fill the rest of the batch with the most recent speculative positions
+    std::vector<Node *> speculated;
+    while ((int)inputs.size() < m_BatchSize && !m_Speculative.empty())
+    {
+        speculated.push_back(m_Speculative.back().first);
+        inputs.push_back(m_Speculative.back().second);
+        m_Speculative.pop_back();
+    }
+
+    torch::Tensor                           input  = torch::cat(inputs, 0);
+    std::pair<torch::Tensor, torch::Tensor> output = m_NN->predict(input);
+    m_Batches++;
+    m_Positions += (int)inputs.size();
+    m_Speculated += (int)speculated.size();
+
+    for (int i = 0; i < (int)batch.size(); i++)
+    {
+        batch[i].first->result = Evaluation{output.first[i], output.second[i].item<float>()};
+    }
+    for (int i = 0; i < (int)speculated.size(); i++)
+    {
+        int const row = (int)batch.size() + i;
+        speculated[i]->setEvaluation(output.first[row], output.second[row].item<float>());
+    }
+    for (auto const & [awaiter, handle]: batch)
+    {
+        handle.resume();
+    }
+}
+
+int BatchEvaluator::getPending() const
+{
+    return (int)m_Queue.size();
+}
+
+int BatchEvaluator::getBatchSize() const
+{
+    return m_BatchSize;
+}
+
+void BatchEvaluator::logStatistics() const
+{
+    float fill = m_Batches > 0 ? (float)m_Positions / (float)m_Batches : 0.0f;
+    LINFO << "Batched inference: " << m_Positions << " positions in " << m_Batches << " batches, average batch " << fill << " / " << m_BatchSize;
+    if (m_Speculated > 0)
+    {
+        LINFO << "Speculative evaluations: " << m_Speculated << ", used by " << m_SpeculativeHits << " simulations";
+    }
+    if (m_Collisions > 0)
+    {
+        LINFO << "Collisions: " << m_Collisions << " selections of a leaf that was already waiting";
+    }
+}
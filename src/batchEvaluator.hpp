@@ -0,0 +1,194 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <vector>
+
+#include "common.hpp"
+#include "neuralNetwork.hpp"
+#include "tree/node.hpp"
+
+/**
+ * @brief A coroutine that runs one MCTS simulation. It starts running immediately,
+ * and is suspended while its leaf waits for the network.
+ * The owner destroys it once it is done.
+ *
+ */
+class SimulationTask
+{
+  public:
+    struct promise_type
+    {
+        SimulationTask get_return_object()
+        {
+            return SimulationTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+        // stay suspended at the end, so the owner can check done()
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    explicit SimulationTask(std::coroutine_handle<promise_type> handle);
+    SimulationTask(SimulationTask && other) noexcept;
+    SimulationTask & operator=(SimulationTask && other) noexcept;
+    SimulationTask(SimulationTask const &)             = delete;
+    SimulationTask & operator=(SimulationTask const &) = delete;
+    ~SimulationTask();
+
+    /**
+     * @brief Return true if the simulation has finished
+     *
+     * @return bool
+     */
+    bool done() const;
+
+  private:
+    std::coroutine_handle<promise_type> m_Handle = nullptr;
+};
+
+/**
+ * @brief Collects the positions of suspended simulations into batches,
+ * runs the network once per batch, and resumes the simulations with their results.
+ * Can be shared by the trees of many games, all driven from one thread.
+ *
+ */
+class BatchEvaluator
+{
+  public:
+    /**
+     * @brief The awaitable returned by evaluate()
+     *
+     */
+    struct Awaiter
+    {
+        BatchEvaluator & evaluator;
+        torch::Tensor    input;
+        Evaluation       result;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            evaluator.enqueue(this, handle);
+        }
+        Evaluation await_resume()
+        {
+            return result;
+        }
+    };
+
+    /**
+     * @brief Construct a new batch evaluator
+     *
+     * @param nn: the network to run the batches on
+     * @param batchSize: the amount of positions to collect before running the network
+     * @param timeout: the longest time a position waits for the batch to fill up
+     */
+    BatchEvaluator(std::shared_ptr<NeuralNetwork> nn, int batchSize, std::chrono::microseconds timeout);
+    ~BatchEvaluator();
+
+    /**
+     * @brief co_await the result of this to evaluate the given input in the next batch
+     *
+     * @param input: the network input for a single position
+     * @return Awaiter
+     */
+    Awaiter evaluate(torch::Tensor input);
+
+    /**
+     * @brief Queue a position for evaluation with low priority: it only fills batch slots no simulation needs.
+     * The result is stored on the node. Speculative positions that never fit in a batch are dropped.
+     * The node must stay alive until the evaluator is flushed for the last time.
+     *
+     * @param node: the node to store the evaluation on
+     * @param input: the network input for the node's position
+     */
+    void speculate(Node * node, torch::Tensor input);
+
+    /**
+     * @brief Drop all speculative positions that haven't been evaluated yet,
+     * e.g. before the tree their nodes belong to changes.
+     *
+     */
+    void clearSpeculative();
+
+    /**
+     * @brief Count a simulation that could use a speculative evaluation instead of waiting for the network
+     *
+     */
+    void recordSpeculativeHit();
+
+    /**
+     * @brief Count a simulation that selected a leaf already waiting for the network, and was not started
+     *
+     */
+    void recordCollision();
+
+    /**
+     * @brief Return true if the batch is full, or its oldest position has waited too long
+     *
+     * @return bool
+     */
+    bool shouldFlush() const;
+
+    /**
+     * @brief Run the network on every waiting position and resume their simulations
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get the amount of positions waiting for the network
+     *
+     * @return int
+     */
+    int getPending() const;
+
+    /**
+     * @brief Get the amount of positions to collect per batch
+     *
+     * @return int
+     */
+    int getBatchSize() const;
+
+    /**
+     * @brief Log the amount of batches and how full they were
+     *
+     */
+    void logStatistics() const;
+
+  private:
+    /**
+     * @brief Add a suspended simulation to the next batch
+     *
+     */
+    void enqueue(Awaiter * awaiter, std::coroutine_handle<> handle);
+
+    std::shared_ptr<NeuralNetwork>                            m_NN = nullptr;
+    int                                                       m_BatchSize;
+    std::chrono::microseconds                                 m_Timeout;
+    std::vector<std::pair<Awaiter *, std::coroutine_handle<>>> m_Queue;
+    std::chrono::steady_clock::time_point                     m_OldestRequest;
+    // low priority positions, newest last
+    std::vector<std::pair<Node *, torch::Tensor>> m_Speculative;
+
+    int m_Batches         = 0;
+    int m_Positions       = 0;
+    int m_Speculated      = 0;
+    int m_SpeculativeHits = 0;
+    int m_Collisions      = 0;
+};
@@ -21,4 +21,9 @@ inline std::uniform_int_distribution<int> g_UniformIntDist;
 inline std::default_random_engine g_Generator;
 // gamma distribution to add dirichlet noise
 inline std::gamma_distribution<double> g_GammaDist(1.5, 1.0);
-inline float cpuct = 4.0f;
\ No newline at end of file
+inline float cpuct = 4.0f;
+// constants of the sigma(q) transformation used by the gumbel root search
+inline float cvisit = 50.0f;
+inline float cscale = 1.0f;
+// consecutive convergence checks below the threshold before an adaptive search stops
+inline int convergenceChecks = 2;
\ No newline at end of file
@@ -283,6 +283,21 @@ ePlayer Environment::getWinner() const
     }
 }
 
+std::vector<int> Environment::getMoveHistory() const
+{
+    std::vector<int> moves;
+    for (auto const & cell: m_BoardHistory)
+    {
+        moves.push_back(cell.getCol());
+    }
+    return moves;
+}
+
+size_t Environment::getMemoryUsage() const
+{
+    return sizeof(Environment) + m_Board.nbytes() + m_BoardHistory.capacity() * sizeof(Cell);
+}
+
 void Environment::print()
 {
     std::stringstream ss;
@@ -153,6 +153,20 @@ class Environment
      */
     ePlayer getWinner() const;
 
+    /**
+     * @brief Get the columns of every move played so far, in order.
+     *
+     * @return std::vector<int>
+     */
+    std::vector<int> getMoveHistory() const;
+
+    /**
+     * @brief Estimate the amount of memory this environment uses.
+     *
+     * @return size_t: the size in bytes
+     */
+    size_t getMemoryUsage() const;
+
     /**
      * @brief Print the current board
      *
@@ -1,5 +1,8 @@
 #include "dataset.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 #include "utils/types.hpp"
 #include "utils/utils.hpp"
 #include <ATen/ops/tensor.h>
@@ -77,3 +80,18 @@ torch::optional<size_t> C4Dataset::size() const
 {
     return m_Data.size();
 }
+
+torch::Tensor C4Dataset::sampleInputs(size_t amount) const
+{
+    std::vector<size_t> indices(m_Data.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::shuffle(indices.begin(), indices.end(), g_Generator);
+    indices.resize(std::min(amount, indices.size()));
+
+    std::vector<torch::Tensor> inputs;
+    for (size_t index: indices)
+    {
+        inputs.push_back(m_Data[index].first);
+    }
+    return torch::stack(inputs);
+}
@@ -46,6 +46,14 @@ class C4Dataset : public torch::data::datasets::Dataset<C4Dataset>
      */
     torch::optional<size_t> size() const override;
 
+    /**
+     * @brief Stack the inputs of random samples, e.g. to calibrate a quantized network
+     *
+     * @param amount: the amount of samples, at most the size of the dataset
+     * @return torch::Tensor: the stacked inputs
+     */
+    torch::Tensor sampleInputs(size_t amount) const;
+
   private:
     std::vector<Data>                m_Data;
     Settings* m_Settings;
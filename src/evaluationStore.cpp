@@ -0,0 +1,181 @@
+#include "evaluationStore.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "utils/utils.hpp"
+
+// stop adding entries above this fill rate, so probe sequences stay short
+static constexpr float maxLoadFactor = 0.9f;
+
+EvaluationStore::EvaluationStore(std::filesystem::path path, int capacity)
+  : m_Path(std::move(path))
+  , m_Capacity((uint32_t)std::max(1, capacity))
+{
+}
+
+EvaluationStore::~EvaluationStore()
+{
+    unmap();
+}
+
+void EvaluationStore::unmap()
+{
+    if (m_Header != nullptr)
+    {
+        munmap(m_Header, m_Size);
+        m_Header  = nullptr;
+        m_Entries = nullptr;
+    }
+    if (m_Fd >= 0)
+    {
+        close(m_Fd);
+        m_Fd = -1;
+    }
+}
+
+bool EvaluationStore::prepare(uint64_t modelChecksum)
+{
+    if (m_Failed)
+    {
+        return false;
+    }
+    if (m_Header == nullptr)
+    {
+        if (m_Path.has_parent_path())
+        {
+            std::filesystem::create_directories(m_Path.parent_path());
+        }
+        m_Fd = open(m_Path.c_str(), O_RDWR | O_CREAT, 0644);
+        struct stat status;
+        if (m_Fd < 0 || fstat(m_Fd, &status) != 0)
+        {
+            LWARN << "Could not open evaluation store " << m_Path;
+            m_Failed = true;
+            unmap();
+            return false;
+        }
+
+        // a file of another size can't be this table: start over
+        m_Size = sizeof(Header) + (size_t)m_Capacity * sizeof(Entry);
+        if ((size_t)status.st_size != m_Size && (ftruncate(m_Fd, 0) != 0 || ftruncate(m_Fd, m_Size) != 0))
+        {
+            LWARN << "Could not resize evaluation store " << m_Path;
+            m_Failed = true;
+            unmap();
+            return false;
+        }
+        void * data = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, m_Fd, 0);
+        if (data == MAP_FAILED)
+        {
+            LWARN << "Could not map evaluation store " << m_Path;
+            m_Failed = true;
+            unmap();
+            return false;
+        }
+        m_Header  = static_cast<Header *>(data);
+        m_Entries = reinterpret_cast<Entry *>(static_cast<char *>(data) + sizeof(Header));
+        if (std::memcmp(m_Header->magic, Header().magic, sizeof(m_Header->magic)) == 0 && m_Header->version == Header().version
+            && m_Header->capacity == m_Capacity)
+        {
+            LINFO << "Opened evaluation store " << m_Path << " with " << m_Header->count << " evaluations";
+        }
+        else
+        {
+            // a new or foreign file: make sure the model check below clears it
+            m_Header->modelChecksum = ~modelChecksum;
+        }
+    }
+
+    if (m_Header->modelChecksum != modelChecksum)
+    {
+        // evaluations of another model are worthless
+        if (m_Header->count > 0)
+        {
+            LINFO << "Dropping " << m_Header->count << " evaluations of another model from " << m_Path;
+        }
+        std::memset(m_Entries, 0, (size_t)m_Capacity * sizeof(Entry));
+        *m_Header               = Header();
+        m_Header->modelChecksum = modelChecksum;
+        m_Header->capacity      = m_Capacity;
+    }
+    return true;
+}
+
+std::optional<std::pair<torch::Tensor, float>> EvaluationStore::lookup(uint64_t modelChecksum, uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!prepare(modelChecksum))
+    {
+        return std::nullopt;
+    }
+    // linear probing: the position is stored before the first empty slot, or not at all
+    for (uint32_t i = 0; i < m_Capacity; i++)
+    {
+        Entry const & entry = m_Entries[(key + i) % m_Capacity];
+        if (entry.key == key)
+        {
+            m_Hits++;
+            torch::Tensor policy = torch::from_blob(const_cast<float *>(entry.policy), {7}, torch::kFloat32).clone();
+            return std::make_pair(policy, entry.value);
+        }
+        if (entry.key == 0)
+        {
+            break;
+        }
+    }
+    m_Misses++;
+    return std::nullopt;
+}
+
+void EvaluationStore::insert(uint64_t modelChecksum, uint64_t key, torch::Tensor const & policy, float value)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!prepare(modelChecksum) || (float)m_Header->count >= maxLoadFactor * (float)m_Capacity)
+    {
+        return;
+    }
+    torch::Tensor cpuPolicy = policy.detach().to(torch::kCPU).to(torch::kFloat32).contiguous().view({-1});
+    for (uint32_t i = 0; i < m_Capacity; i++)
+    {
+        Entry & entry = m_Entries[(key + i) % m_Capacity];
+        if (entry.key == key)
+        {
+            // already stored by another search
+            return;
+        }
+        if (entry.key == 0)
+        {
+            std::memcpy(entry.policy, cpuPolicy.data_ptr<float>(), sizeof(entry.policy));
+            entry.value = value;
+            entry.key   = key;
+            m_Header->count++;
+            return;
+        }
+    }
+}
+
+uint64_t EvaluationStore::positionKey(std::shared_ptr<Environment> const & env)
+{
+    // FNV-1a over the board and the player to move
+    std::vector<uint8_t> board = utils::boardToVector(env->getBoard());
+    board.push_back(static_cast<uint8_t>(env->getCurrentPlayer()));
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (uint8_t byte: board)
+    {
+        hash ^= byte;
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+void EvaluationStore::logStatistics() const
+{
+    uint32_t stored = m_Header != nullptr ? m_Header->count : 0;
+    LINFO << "Evaluation store " << m_Path << ": " << stored << " / " << m_Capacity << " evaluations, " << m_Hits << " hits, "
+          << m_Misses << " misses";
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+
+#include "common.hpp"
+#include "connect4/environment.hpp"
+
+/**
+ * @brief A persistent cache of network evaluations, so a restarted self-play run doesn't have to
+ * evaluate the same positions again.
+ * The file is a memory-mapped hash table with a fixed capacity. Entries are only ever added,
+ * until the table is nearly full. The table belongs to a single model: once it is used with a different model
+ * (e.g. after a model promotion), all entries are dropped.
+ * The file is only opened when the store is first used.
+ *
+ */
+class EvaluationStore
+{
+  public:
+    /**
+     * @brief The start of an evaluation store file, followed by the entries
+     *
+     */
+    struct Header
+    {
+        char     magic[4]      = {'C', '4', 'E', 'V'};
+        uint32_t version       = 1;
+        uint64_t modelChecksum = 0;
+        uint32_t capacity      = 0;
+        uint32_t count         = 0;
+    };
+
+    /**
+     * @brief A single evaluation. A key of 0 marks an empty slot.
+     *
+     */
+    struct Entry
+    {
+        uint64_t key;
+        float    policy[7];
+        float    value;
+    };
+    static_assert(sizeof(Entry) == 40, "Entry must stay 40 bytes");
+
+    /**
+     * @brief Construct a new evaluation store. The file is not opened yet.
+     *
+     * @param path: the file to keep the evaluations in
+     * @param capacity: the maximum amount of evaluations
+     */
+    EvaluationStore(std::filesystem::path path, int capacity);
+    ~EvaluationStore();
+
+    EvaluationStore(EvaluationStore const &)             = delete;
+    EvaluationStore & operator=(EvaluationStore const &) = delete;
+
+    /**
+     * @brief Find the evaluation of a position by the given model
+     *
+     * @param modelChecksum: the checksum of the model's weights
+     * @param key: the key of the position, from positionKey()
+     * @return std::optional<std::pair<torch::Tensor, float>>: the policy and value output, if stored
+     */
+    std::optional<std::pair<torch::Tensor, float>> lookup(uint64_t modelChecksum, uint64_t key);
+
+    /**
+     * @brief Store the evaluation of a position by the given model. Ignored if the table is nearly full.
+     *
+     * @param modelChecksum: the checksum of the model's weights
+     * @param key: the key of the position, from positionKey()
+     * @param policy: the policy output, one value per column
+     * @param value: the value output
+     */
+    void insert(uint64_t modelChecksum, uint64_t key, torch::Tensor const & policy, float value);
+
+    /**
+     * @brief Calculate a key that identifies the position (board + player to move) of an environment
+     *
+     * @param env: the environment
+     * @return uint64_t: the key, never 0
+     */
+    static uint64_t positionKey(std::shared_ptr<Environment> const & env);
+
+    /**
+     * @brief Log the amount of stored evaluations, hits and misses
+     *
+     */
+    void logStatistics() const;
+
+  private:
+    /**
+     * @brief Map the file if needed, and drop its entries if they belong to a different model.
+     * Must be called with the mutex locked.
+     *
+     * @param modelChecksum: the checksum of the model that uses the store
+     * @return true if the table can be used
+     */
+    bool prepare(uint64_t modelChecksum);
+
+    /**
+     * @brief Unmap the file
+     *
+     */
+    void unmap();
+
+    std::filesystem::path m_Path;
+    uint32_t              m_Capacity = 0;
+    std::mutex            m_Mutex;
+
+    int      m_Fd      = -1;
+    size_t   m_Size    = 0;
+    Header * m_Header  = nullptr;
+    Entry *  m_Entries = nullptr;
+    bool     m_Failed  = false; // don't retry a file that could not be opened
+
+    int m_Hits   = 0;
+    int m_Misses = 0;
+};
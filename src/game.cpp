@@ -9,6 +9,13 @@ Game::Game(std::shared_ptr<Settings> settings, std::pair<std::shared_ptr<Agent>,
     m_Agents.emplace_back(agents.first);
     m_Agents.emplace_back(agents.second);
 
+    // with the same network, the tree of one side is also valid for the other side
+    if (m_Settings->useSharedTree() && agents.first->getModel() == agents.second->getModel())
+    {
+        m_SharedMCTS = agents.first->getMCTS();
+        LDEBUG << "Both agents share one search tree";
+    }
+
     // create a random id
     std::string current_date = std::to_string(std::time(nullptr));
     m_GameID                 = "game-" + current_date + "-" + std::to_string(g_UniformIntDist(g_Generator));
@@ -21,6 +28,33 @@ std::shared_ptr<Environment> Game::getEnvironment() const
     return m_Env;
 }
 
+void Game::setOpening(std::vector<int> const & moves)
+{
+    for (int move: moves)
+    {
+        if (!m_Env->isValidMove(move))
+        {
+            LFATAL << "Invalid opening move: " << move;
+        }
+        m_Env->makeMove(move);
+    }
+}
+
+void Game::setSearchCache(std::shared_ptr<SearchCache> cache)
+{
+    m_SearchCache = cache;
+}
+
+void Game::setOpeningTree(std::shared_ptr<OpeningTree> openingTree)
+{
+    m_OpeningTree = openingTree;
+}
+
+bool Game::usesSharedTree() const
+{
+    return m_SharedMCTS != nullptr;
+}
+
 ePlayer Game::playGame()
 {
     ePlayer winner = ePlayer::NONE;
@@ -35,6 +69,11 @@ ePlayer Game::playGame()
         }
     }
 
+    for (auto const & agent: m_Agents)
+    {
+        agent->getMCTS()->stopPondering();
+    }
+
     m_Env->togglePlayer();
     winner = m_Env->getWinner();
 
@@ -64,28 +103,116 @@ bool Game::playMove()
     // get agent
     int                    currentAgent = m_Env->getCurrentPlayer() == ePlayer::YELLOW ? 0 : m_Env->getCurrentPlayer() == ePlayer::RED ? 1 : -1;
     std::shared_ptr<Agent> agent        = m_Agents.at(currentAgent);
-    std::shared_ptr<MCTS>  mcts         = agent->getMCTS();
+    std::shared_ptr<MCTS>  mcts         = usesSharedTree() ? m_SharedMCTS : agent->getMCTS();
 
-    if (m_PreviousMoves.first != -1 && m_PreviousMoves.second != -1)
+    if (usesSharedTree())
+    {
+        // the shared tree was moved to the current position after the previous move
+        if (m_PreviousMoves.second == -1)
+        {
+            mcts->setRoot(std::make_unique<Node>(m_Env));
+        }
+    }
+    else if (mcts->isPondering())
+    {
+        // the tree already starts after this agent's previous move: only the opponent's move is left
+        mcts->stopPondering();
+        Node * newRoot = mcts->getRoot()->getChildAfterMove(m_PreviousMoves.second);
+        if (newRoot != nullptr)
+        {
+            mcts->setRoot(newRoot);
+        }
+        else
+        {
+            // the opponent's move was never reached while pondering
+            mcts->setRoot(std::make_unique<Node>(m_Env));
+        }
+    }
+    else if (m_PreviousMoves.first != -1 && m_PreviousMoves.second != -1)
     {
         Node * newRoot = mcts->getRoot()->getChildAfterMove(m_PreviousMoves.first);
-        if (newRoot == nullptr)
+        if (newRoot != nullptr)
         {
-            LFATAL << "NewRoot after getting first child is null!";
+            newRoot = newRoot->getChildAfterMove(m_PreviousMoves.second);
         }
-        newRoot = newRoot->getChildAfterMove(m_PreviousMoves.second);
-        if (newRoot == nullptr)
+        if (newRoot != nullptr)
         {
-            LFATAL << "NewRoot after getting second child is null!";
+            mcts->setRoot(newRoot);
+        }
+        else
+        {
+            // the tree never reached this position, e.g. because the previous move came from the search cache
+            mcts->setRoot(std::make_unique<Node>(m_Env));
         }
-        mcts->setRoot(newRoot);
     }
     else
     {
         mcts->setRoot(std::make_unique<Node>(m_Env));
     }
 
-    mcts->run_simulations(m_Settings->getSimulations());
+    // a deterministic search in a position that was searched before always chooses the same move
+    std::vector<int> moveHistory = m_Env->getMoveHistory();
+    int              cachedMove  = -1;
+    if (m_SearchCache != nullptr && !m_Settings->isStochastic() && m_SearchCache->lookup(agent->getName(), m_Env, cachedMove))
+    {
+        LINFO << "Playing cached move: " << cachedMove;
+        return makeMove(mcts, cachedMove);
+    }
+
+    // in the opening, start from everything earlier games searched in this position
+    bool seeded = false;
+    if (m_OpeningTree != nullptr && m_OpeningTree->covers((int)moveHistory.size()))
+    {
+        std::unique_ptr<Node> openingRoot = m_OpeningTree->seed(m_Env, agent->getModel());
+        if (openingRoot != nullptr)
+        {
+            mcts->setRoot(std::move(openingRoot));
+            seeded = true;
+        }
+    }
+
+    // playout cap randomization: most moves get a cheap search and are not used as policy targets
+    bool fullSearch = true;
+    if (m_Settings->getFastSimulations() > 0)
+    {
+        std::bernoulli_distribution fullSearchDist(m_Settings->getFullSearchProbability());
+        fullSearch = fullSearchDist(g_Generator);
+    }
+    int simulations = fullSearch ? m_Settings->getSimulations() : m_Settings->getFastSimulations();
+    // the fast searches don't explore: no noise, so their moves are as strong as possible
+    mcts->setExploration(fullSearch);
+    if (m_Settings->useGumbel())
+    {
+        mcts->run_gumbel(simulations);
+    }
+    else if (m_Settings->getSearchBatchSize() > 0)
+    {
+        mcts->run_batched(simulations);
+    }
+    else if (m_Settings->getRootParallelSearches() > 1)
+    {
+        mcts->run_root_parallel(simulations, m_Settings->getRootParallelSearches());
+    }
+    else if (m_Settings->useAdaptiveSimulations() && fullSearch && simulations > 0)
+    {
+        // an adaptive search stops early on easy moves: the rest of its budget goes to the next moves
+        int budget = simulations + m_SavedSimulations[currentAgent];
+        mcts->run_simulations(budget);
+        m_SavedSimulations[currentAgent] = budget - mcts->getSimulationsUsed();
+        LDEBUG << "Used " << mcts->getSimulationsUsed() << " of " << budget << " simulations";
+    }
+    else
+    {
+        mcts->run_simulations(simulations);
+    }
+    if (m_Settings->logTreeStatistics())
+    {
+        mcts->logTreeStatistics();
+    }
+    if (seeded)
+    {
+        m_OpeningTree->update(mcts->getRoot().get(), agent->getModel());
+    }
 
     std::unique_ptr<Node> const & currentRoot = mcts->getRoot();
     // calculate average action-value of all actions in the root node
@@ -98,7 +225,15 @@ bool Game::playMove()
     LINFO << "Average action-value according to current player (" << agent->getName() << "): " << value;
 
     // get best move from mcts tree
-    int bestMove = m_Settings->isStochastic() ? mcts->getBestMoveStochastic() : mcts->getBestMoveDeterministic();
+    int bestMove = 0;
+    if (m_Settings->useGumbel())
+    {
+        bestMove = mcts->getGumbelMove();
+    }
+    else
+    {
+        bestMove = m_Settings->isStochastic() ? mcts->getBestMoveStochastic() : mcts->getBestMoveDeterministic();
+    }
 
     // print moves and their q + u values
     std::vector<float> moveProbs = std::vector<float>(m_Env->getCols(), 0.0f);
@@ -110,6 +245,11 @@ bool Game::playMove()
             LDEBUG << "Move: " << child->getMove() << " Q: " << child->getQ() << " U: " << child->getU() << ". Visits: " << child->getVisits();
         }
     }
+    if (m_Settings->useGumbel())
+    {
+        // visit counts of a gumbel search are not a policy: use the completed-Q policy instead
+        moveProbs = mcts->getImprovedPolicy();
+    }
 
     if (m_Settings->saveMemory())
     {
@@ -119,6 +259,7 @@ bool Game::playMove()
         element.currentPlayer = static_cast<uint8_t>(m_Env->getCurrentPlayer());
         element.moveList      = moveProbs;
         element.winner        = 0;
+        element.fullSearch    = fullSearch;
         // save element to memory
         addElementToMemory(element);
 
@@ -129,17 +270,47 @@ bool Game::playMove()
     }
 
     LINFO << "Playing best move: " << bestMove;
+    if (m_SearchCache != nullptr && !m_Settings->isStochastic())
+    {
+        m_SearchCache->store(agent->getName(), m_Env, bestMove);
+    }
+
+    return makeMove(mcts, bestMove);
+}
 
-    // make the best move
-    m_Env->makeMove(bestMove);
+bool Game::makeMove(std::shared_ptr<MCTS> const & mcts, int move)
+{
+    Node * ponderRoot = mcts->getRoot()->getChildAfterMove(move);
+
+    // make the move
+    m_Env->makeMove(move);
     m_Env->print();
 
+    bool gameOver = !m_Env->hasValidMoves() || m_Env->currentPlayerHasConnected4();
+    if (usesSharedTree() && !gameOver)
+    {
+        // the opponent continues in the subtree that was just searched
+        if (ponderRoot != nullptr)
+        {
+            mcts->setRoot(ponderRoot);
+        }
+        else
+        {
+            mcts->setRoot(std::make_unique<Node>(m_Env));
+        }
+    }
+    else if (m_Settings->usePondering() && !gameOver && ponderRoot != nullptr)
+    {
+        // search the opponent's position until the opponent has moved
+        mcts->setRoot(ponderRoot);
+        mcts->startPondering();
+    }
+
     m_PreviousMoves.first  = m_PreviousMoves.second;
-    m_PreviousMoves.second = bestMove;
+    m_PreviousMoves.second = move;
 
     std::cout << "\n==============================================\n" << std::endl;
-    return !m_Env->hasValidMoves() || m_Env->currentPlayerHasConnected4();
-
+    return gameOver;
 }
 
 void Game::updateMemoryWithWinner(ePlayer winner)
@@ -159,7 +330,17 @@ bool Game::saveMemoryToFile()
         std::filesystem::create_directories(folder);
     }
     std::filesystem::path file = folder / (m_GameID + ".bin");
-    return utils::writeMemoryElementsToFile(m_Memory, file);
+
+    // only the moves with a full search are good enough to train the policy on
+    std::vector<MemoryElement> recorded;
+    std::copy_if(m_Memory.begin(), m_Memory.end(), std::back_inserter(recorded), [](MemoryElement const & element) { return element.fullSearch; });
+    LINFO << "Saving " << recorded.size() << " of " << m_Memory.size() << " positions to " << file;
+    if (recorded.empty())
+    {
+        // nothing worth training on in this game
+        return true;
+    }
+    return utils::writeMemoryElementsToFile(recorded, file);
 }
 
 void Game::addElementToMemory(MemoryElement element)
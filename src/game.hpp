@@ -3,6 +3,8 @@
 #include "agent.hpp"
 #include "common.hpp"
 #include "connect4/environment.hpp"
+#include "searchCache.hpp"
+#include "tree/openingTree.hpp"
 #include "utils/settings.hpp"
 #include "utils/types.hpp"
 
@@ -19,6 +21,11 @@ class Game
     std::pair<int, int>               m_PreviousMoves = std::make_pair<int, int>(-1, -1);
 
     std::vector<std::shared_ptr<Agent>> m_Agents = std::vector<std::shared_ptr<Agent>>();
+    std::shared_ptr<MCTS>               m_SharedMCTS = nullptr; // the tree of both sides, if they share a network
+    std::shared_ptr<SearchCache>        m_SearchCache = nullptr;
+    std::shared_ptr<OpeningTree>        m_OpeningTree = nullptr;
+    // simulations per agent left over by adaptive searches, added to their next full search
+    std::vector<int> m_SavedSimulations = std::vector<int>(2, 0);
 
     std::vector<MemoryElement> m_Memory;
 
@@ -51,6 +58,15 @@ class Game
      */
     bool playMove();
 
+    /**
+     * @brief Play the given move, and move the searching tree along with it
+     *
+     * @param mcts: the tree that was searched for this move
+     * @param move: the column to play
+     * @return true if the game is finished.
+     */
+    bool makeMove(std::shared_ptr<MCTS> const & mcts, int move);
+
     /**
      * @brief Add a single element to the current memory.
      * Does not include the winner, which needs to be added at the end of the game.
@@ -80,4 +96,34 @@ class Game
      */
     std::shared_ptr<Environment> getEnvironment() const;
 
+    /**
+     * @brief Start the game from the position after the given moves instead of the empty board.
+     * Must be called before the game is played.
+     *
+     * @param moves: the opening moves, in columns
+     */
+    void setOpening(std::vector<int> const & moves);
+
+    /**
+     * @brief Reuse the moves of earlier deterministic searches in the same positions.
+     * Only used if the search is not stochastic.
+     *
+     * @param cache: the cache, shared by all games of a match
+     */
+    void setSearchCache(std::shared_ptr<SearchCache> cache);
+
+    /**
+     * @brief Start the searches in the opening from a tree that is shared with other games
+     *
+     * @param openingTree: the opening tree, shared by all games with the same model
+     */
+    void setOpeningTree(std::shared_ptr<OpeningTree> openingTree);
+
+    /**
+     * @brief Whether both sides search in the same tree, which then advances one ply per move
+     *
+     * @return true if the tree is shared
+     */
+    bool usesSharedTree() const;
+
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "inferenceServer.hpp"
+
+#include <cmath>
+#include <sstream>
+
+void InferenceServer::Histogram::add(double value)
+{
+    int bucket = value < 1.0 ? 0 : std::min((int)buckets.size() - 1, (int)std::log2(value) + 1);
+    buckets[bucket]++;
+    count++;
+    sum += value;
+}
+
+std::string InferenceServer::Histogram::toString() const
+{
+    std::stringstream stream;
+    stream << "mean " << (count > 0 ? sum / (double)count : 0.0) << " |";
+    for (int i = 0; i < (int)buckets.size(); i++)
+    {
+        if (buckets[i] > 0)
+        {
+            stream << " <" << (1L << i) << ":" << buckets[i];
+        }
+    }
+    return stream.str();
+}
+
+InferenceServer::InferenceServer(int maxBatchSize, std::chrono::microseconds maxWait)
+  : m_MaxBatchSize(std::max(1, maxBatchSize))
+  , m_MaxWait(maxWait)
+{
+    m_Thread = std::thread(&InferenceServer::serve, this);
+}
+
+InferenceServer::~InferenceServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+    m_Thread.join();
+}
+
+int InferenceServer::addModel(std::shared_ptr<NeuralNetwork> nn)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Models.push_back(Model{nn, {}});
+    return (int)m_Models.size() - 1;
+}
+
+std::future<Evaluation> InferenceServer::submit(int model, torch::Tensor input)
+{
+    auto                    promise = std::make_shared<std::promise<Evaluation>>();
+    std::future<Evaluation> result  = promise->get_future();
+    submit(model, std::move(input), [promise](Evaluation evaluation) { promise->set_value(std::move(evaluation)); });
+    return result;
+}
+
+void InferenceServer::submit(int model, torch::Tensor input, std::function<void(Evaluation)> callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Models.at(model).queue.push_back(Request{std::move(input), std::move(callback), std::chrono::steady_clock::now()});
+    }
+    m_Condition.notify_one();
+}
+
+void InferenceServer::serve()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        // find a model with a full batch, or with a request that has waited long enough
+        auto   now      = std::chrono::steady_clock::now();
+        auto   deadline = std::chrono::steady_clock::time_point::max();
+        Model * ready   = nullptr;
+        for (Model & model: m_Models)
+        {
+            if (model.queue.empty())
+            {
+                continue;
+            }
+            auto modelDeadline = model.queue.front().submitted + m_MaxWait;
+            if ((int)model.queue.size() >= m_MaxBatchSize || modelDeadline <= now || m_Stop)
+            {
+                ready = &model;
+                break;
+            }
+            deadline = std::min(deadline, modelDeadline);
+        }
+
+        if (ready == nullptr)
+        {
+            if (m_Stop)
+            {
+                return;
+            }
+            if (deadline == std::chrono::steady_clock::time_point::max())
+            {
+                m_Condition.wait(lock);
+            }
+            else
+            {
+                m_Condition.wait_until(lock, deadline);
+            }
+            continue;
+        }
+
+        m_QueueDepth.add((double)ready->queue.size());
+        int                  size = std::min((int)ready->queue.size(), m_MaxBatchSize);
+        std::vector<Request> batch(std::make_move_iterator(ready->queue.begin()), std::make_move_iterator(ready->queue.begin() + size));
+        ready->queue.erase(ready->queue.begin(), ready->queue.begin() + size);
+        std::shared_ptr<NeuralNetwork> nn = ready->nn;
+
+        // callers can keep submitting while the network runs
+        lock.unlock();
+        runBatch(nn, batch);
+        lock.lock();
+    }
+}
+
+void InferenceServer::runBatch(std::shared_ptr<NeuralNetwork> const & model, std::vector<Request> & requests)
+{
+    torch::NoGradGuard         noGrad;
+    std::vector<torch::Tensor> inputs;
+    for (Request const & request: requests)
+    {
+        inputs.push_back(request.input);
+    }
+    torch::Tensor                           input  = torch::cat(inputs, 0);
+    std::pair<torch::Tensor, torch::Tensor> output = model->predict(input);
+
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < (int)requests.size(); i++)
+    {
+        requests[i].callback(Evaluation{output.first[i], output.second[i].item<float>()});
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_BatchFill.add((double)requests.size());
+    for (Request const & request: requests)
+    {
+        m_Latency.add((double)std::chrono::duration_cast<std::chrono::microseconds>(now - request.submitted).count());
+    }
+}
+
+void InferenceServer::logStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    LINFO << "Inference server: " << m_BatchFill.count << " batches of at most " << m_MaxBatchSize << " for " << m_Models.size() << " model(s)";
+    LINFO << "  queue depth: " << m_QueueDepth.toString();
+    LINFO << "  batch fill: " << m_BatchFill.toString();
+    LINFO << "  latency (us): " << m_Latency.toString();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "neuralNetwork.hpp"
+
+/**
+ * @brief Runs the networks of the whole process on a dedicated thread. Callers submit encoded positions
+ * from any thread and get a future or a callback. The thread collects the requests per model into batches,
+ * and runs a batch once it is full or its oldest request has waited long enough.
+ *
+ */
+class InferenceServer
+{
+  public:
+    /**
+     * @brief Counts values in power-of-two buckets: bucket i holds the values in [2^(i-1), 2^i)
+     *
+     */
+    struct Histogram
+    {
+        std::vector<long> buckets = std::vector<long>(24, 0);
+        long              count   = 0;
+        double            sum     = 0.0;
+
+        void add(double value);
+        std::string toString() const;
+    };
+
+    /**
+     * @brief Create the server and start its thread
+     *
+     * @param maxBatchSize: the largest batch to run at once
+     * @param maxWait: the longest time a request waits for its batch to fill up
+     */
+    InferenceServer(int maxBatchSize, std::chrono::microseconds maxWait);
+
+    /**
+     * @brief Stop the thread. Requests that are still waiting are evaluated first.
+     *
+     */
+    ~InferenceServer();
+
+    InferenceServer(InferenceServer const &)             = delete;
+    InferenceServer & operator=(InferenceServer const &) = delete;
+
+    /**
+     * @brief Add a model to serve
+     *
+     * @param nn: the model
+     * @return int: the id to submit requests for this model with
+     */
+    int addModel(std::shared_ptr<NeuralNetwork> nn);
+
+    /**
+     * @brief Evaluate a position with the given model
+     *
+     * @param model: the id from addModel()
+     * @param input: the network input for a single position
+     * @return std::future<Evaluation>: the policy and value output
+     */
+    std::future<Evaluation> submit(int model, torch::Tensor input);
+
+    /**
+     * @brief Evaluate a position with the given model, and call the callback on the server's thread with the result.
+     * The callback must be short, it holds up all other requests.
+     *
+     * @param model: the id from addModel()
+     * @param input: the network input for a single position
+     * @param callback: called with the policy and value output
+     */
+    void submit(int model, torch::Tensor input, std::function<void(Evaluation)> callback);
+
+    /**
+     * @brief Log the queue depth, batch fill and latency histograms
+     *
+     */
+    void logStatistics() const;
+
+  private:
+    /**
+     * @brief A single submitted position
+     *
+     */
+    struct Request
+    {
+        torch::Tensor                         input;
+        std::function<void(Evaluation)>       callback;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    /**
+     * @brief A served model and its waiting requests
+     *
+     */
+    struct Model
+    {
+        std::shared_ptr<NeuralNetwork> nn;
+        std::deque<Request>            queue;
+    };
+
+    /**
+     * @brief The server's thread: wait for a batch to be ready, run it, repeat
+     *
+     */
+    void serve();
+
+    /**
+     * @brief Run a single batch of a model's requests
+     *
+     * @param model: the model to run
+     * @param requests: the requests in the batch
+     */
+    void runBatch(std::shared_ptr<NeuralNetwork> const & model, std::vector<Request> & requests);
+
+    int                       m_MaxBatchSize;
+    std::chrono::microseconds m_MaxWait;
+
+    std::vector<Model>      m_Models;
+    mutable std::mutex      m_Mutex;
+    std::condition_variable m_Condition;
+    bool                    m_Stop = false;
+    std::thread             m_Thread;
+
+    // only written by the server's thread, read under the mutex
+    Histogram m_QueueDepth; // requests waiting for the model when a batch starts
+    Histogram m_BatchFill;  // requests per batch
+    Histogram m_Latency;    // microseconds from submit to result
+};
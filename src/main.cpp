@@ -1,5 +1,7 @@
 #include <signal.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
@@ -8,6 +10,7 @@
 #include <string>
 
 #include "common.hpp"
+#include "dataset.hpp"
 #include "game.hpp"
 #include "train.hpp"
 #include "utils/inputParser.hpp"
@@ -28,14 +31,55 @@ void signal_handling(int signal)
     std::cout << "Options:" << std::endl;
     std::cout << "  -h, --help\t\tPrint this help message" << std::endl;
     std::cout << "  --sims\t\tAmount of simulations" << std::endl;
+    std::cout << "  --fast-sims\t\tPlayout cap randomization: amount of simulations for moves that are not saved" << std::endl;
+    std::cout << "  --full-search-prob\tPlayout cap randomization: probability of a full, saved search" << std::endl;
+    std::cout << "  --gumbel\t\tUse gumbel root search with sequential halving, for small amounts of simulations" << std::endl;
+    std::cout << "  --gumbel-actions\tAmount of root moves sampled by the gumbel search" << std::endl;
+    std::cout << "  --search-batch\tEvaluate this many leaves per network call during search" << std::endl;
+    std::cout << "  --speculate\t\tFill spare batch slots with this many likely children of new nodes" << std::endl;
+    std::cout << "  --inference-batch\tRun the network on a server thread that batches up to this many positions" << std::endl;
+    std::cout << "  --inference-wait\tMicroseconds a position waits for the server's batch to fill" << std::endl;
+    std::cout << "  --root-parallel\tAmount of independent searches per move, merged at the root" << std::endl;
+    std::cout << "  --ponder\t\tKeep searching while the opponent is thinking, implies --separate-trees" << std::endl;
+    std::cout << "  --separate-trees\tGive both sides their own tree, even if they use the same network" << std::endl;
+    std::cout << "  --opening-tree\tKeep the search of this many plies from the start across self-play games" << std::endl;
+    std::cout << "  --movetime\t\tMaximum search time per move in milliseconds" << std::endl;
+    std::cout << "  --nodes\t\tMaximum amount of nodes in the search tree" << std::endl;
+    std::cout << "  --prune\t\tPrune the least visited subtrees instead of stopping at the node budget" << std::endl;
+    std::cout << "  --early-stop\t\tStop searching when the best move can no longer change within the remaining --sims" << std::endl;
+    std::cout << "  --adaptive-sims\tStop searching when the root visits converge, and keep the rest for later moves" << std::endl;
+    std::cout << "  --convergence\t\tKL divergence threshold of the adaptive simulations" << std::endl;
     std::cout << "  --memory-folder\tFolder to save the games to or load the dataset from" << std::endl;
+    std::cout << "  --eval-store\t\tFile to keep network evaluations in across runs" << std::endl;
+    std::cout << "  --eval-store-size\tMaximum amount of evaluations in the evaluation store" << std::endl;
+    std::cout << "  --node-file\t\tKeep the search tree in this file instead of on the heap, so it can grow beyond RAM" << std::endl;
+    std::cout << "  --node-file-size\tMaximum size of the node file in GiB" << std::endl;
     std::cout << "  --train\t\tTrain a new network" << std::endl;
     std::cout << "  --pipeline\t\tRepeatedly run games and retrain the network. Append a number to specify amount of "
                  "games per pipeline."
               << std::endl;
     std::cout << "  --model\t\tPath to model to use for selfplay or training" << std::endl;
+    std::cout << "  --blocks\t\tAmount of residual blocks of a new network" << std::endl;
+    std::cout << "  --filters\t\tAmount of filters of a new network" << std::endl;
+    std::cout << "  --policy-filters\tAmount of filters in the policy head of a new network" << std::endl;
+    std::cout << "  --value-filters\tAmount of filters in the value head of a new network" << std::endl;
+    std::cout << "  --block-type\t\tResidual blocks of a new network: residual, bottleneck, depthwise or depthwise-se" << std::endl;
+    std::cout << "  --block-report\tCompare the FLOPs and latency of every kind of residual block" << std::endl;
+    std::cout << "  --scripted-model\tPath to a frozen TorchScript model to run instead of the eager network" << std::endl;
+    std::cout << "  --export-script\tExport the model to a frozen TorchScript file at the given path" << std::endl;
+    std::cout << "  --benchmark\t\tCompare the latency of the eager and the scripted network" << std::endl;
+    std::cout << "  --int8\t\tRun self-play inference with an int8 network on the CPU" << std::endl;
+    std::cout << "  --calibration\t\tAmount of positions of earlier games that calibrate the int8 network" << std::endl;
+    std::cout << "  --quantization-report\tCompare the int8 network's outputs and speed to the fp32 network" << std::endl;
+    std::cout << "  --small-model\t\tPath to a small, fast model for the less important leaves of the search" << std::endl;
+    std::cout << "  --small-filters\tAmount of filters of the small model" << std::endl;
+    std::cout << "  --small-depth\t\tUse the small model for leaves deeper than this" << std::endl;
+    std::cout << "  --small-visits\tUse the small model for leaves whose parent has fewer visits than this" << std::endl;
     std::cout << "  --lr\t\t\tLearning rate" << std::endl;
     std::cout << "  --bs\t\t\tBatch size" << std::endl;
+    std::cout << "  --tree-stats\t\tLog the size and shape of the search tree after every move" << std::endl;
+    std::cout << "  --load-tree\t\tAnalyse: continue searching the tree saved in this file" << std::endl;
+    std::cout << "  --save-tree\t\tAnalyse: save the search tree to this file after searching" << std::endl;
     std::cout << "  --test\t\tRun tests" << std::endl;
     exit(EXIT_SUCCESS);
 }
@@ -49,6 +93,58 @@ void parseOptions(InputParser const & inputParser, std::shared_ptr<Settings> set
         settings->setModelPath(modelPath);
     }
 
+    // set frozen TorchScript model
+    if (inputParser.cmdOptionExists("--scripted-model"))
+    {
+        settings->setScriptedModelPath(inputParser.getCmdOption("--scripted-model"));
+    }
+
+    // set the architecture of new networks
+    try
+    {
+        if (inputParser.cmdOptionExists("--blocks"))
+        {
+            settings->setResidualBlocks(std::stoi(inputParser.getCmdOption("--blocks")));
+        }
+        if (inputParser.cmdOptionExists("--filters"))
+        {
+            settings->setFilters(std::stoi(inputParser.getCmdOption("--filters")));
+        }
+        if (inputParser.cmdOptionExists("--policy-filters"))
+        {
+            settings->setPolicyFilters(std::stoi(inputParser.getCmdOption("--policy-filters")));
+        }
+        if (inputParser.cmdOptionExists("--value-filters"))
+        {
+            settings->setValueFilters(std::stoi(inputParser.getCmdOption("--value-filters")));
+        }
+        if (inputParser.cmdOptionExists("--block-type"))
+        {
+            settings->setBlockType(blockTypeFromString(inputParser.getCmdOption("--block-type")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid network architecture: " << e.what();
+    }
+
+    // set int8 inference
+    if (inputParser.cmdOptionExists("--int8"))
+    {
+        settings->setQuantizedInference(true);
+    }
+    try
+    {
+        if (inputParser.cmdOptionExists("--calibration"))
+        {
+            settings->setCalibrationSize(std::stoi(inputParser.getCmdOption("--calibration")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid amount of calibration positions: " << e.what();
+    }
+
     // FOR DEBUGGING PURPOSES: show Q+U+visits for every possible action
     settings->setShowMoves(true);
 
@@ -73,6 +169,162 @@ void parseOptions(InputParser const & inputParser, std::shared_ptr<Settings> set
         }
     }
 
+    // set playout cap randomization
+    try
+    {
+        if (inputParser.cmdOptionExists("--fast-sims"))
+        {
+            settings->setFastSimulations(std::stoi(inputParser.getCmdOption("--fast-sims")));
+        }
+        if (inputParser.cmdOptionExists("--full-search-prob"))
+        {
+            settings->setFullSearchProbability(std::stof(inputParser.getCmdOption("--full-search-prob")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid playout cap randomization setting: " << e.what();
+    }
+
+    // set adaptive simulations
+    try
+    {
+        if (inputParser.cmdOptionExists("--adaptive-sims"))
+        {
+            settings->setAdaptiveSimulations(true);
+        }
+        if (inputParser.cmdOptionExists("--convergence"))
+        {
+            settings->setConvergenceThreshold(std::stof(inputParser.getCmdOption("--convergence")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid convergence threshold: " << e.what();
+    }
+
+    // set gumbel root search
+    if (inputParser.cmdOptionExists("--gumbel"))
+    {
+        settings->setGumbel(true);
+    }
+    try
+    {
+        if (inputParser.cmdOptionExists("--gumbel-actions"))
+        {
+            settings->setGumbelActions(std::stoi(inputParser.getCmdOption("--gumbel-actions")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid amount of gumbel actions: " << e.what();
+    }
+
+    // set batched search
+    try
+    {
+        if (inputParser.cmdOptionExists("--search-batch"))
+        {
+            settings->setSearchBatchSize(std::stoi(inputParser.getCmdOption("--search-batch")));
+        }
+        if (inputParser.cmdOptionExists("--speculate"))
+        {
+            settings->setSpeculativeChildren(std::stoi(inputParser.getCmdOption("--speculate")));
+        }
+        if (inputParser.cmdOptionExists("--inference-batch"))
+        {
+            settings->setInferenceBatchSize(std::stoi(inputParser.getCmdOption("--inference-batch")));
+        }
+        if (inputParser.cmdOptionExists("--inference-wait"))
+        {
+            settings->setInferenceWait(std::stoi(inputParser.getCmdOption("--inference-wait")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid batched search setting: " << e.what();
+    }
+
+    // set amount of root-parallel searches
+    try
+    {
+        if (inputParser.cmdOptionExists("--root-parallel"))
+        {
+            settings->setRootParallelSearches(std::stoi(inputParser.getCmdOption("--root-parallel")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid amount of root-parallel searches: " << e.what();
+    }
+
+    // set time and node budget per move
+    try
+    {
+        if (inputParser.cmdOptionExists("--movetime"))
+        {
+            settings->setSearchTime(std::stoi(inputParser.getCmdOption("--movetime")));
+        }
+        if (inputParser.cmdOptionExists("--nodes"))
+        {
+            settings->setSearchNodes(std::stoi(inputParser.getCmdOption("--nodes")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid search budget: " << e.what();
+    }
+    if ((settings->getSearchTime() > 0 || settings->getSearchNodes() > 0) && !inputParser.cmdOptionExists("--sims"))
+    {
+        // only limit the search by time and/or nodes
+        settings->setSimulations(0);
+    }
+    if (settings->useGumbel() && settings->getSimulations() <= 0)
+    {
+        LFATAL << "--gumbel needs an amount of simulations (--sims): sequential halving can't be limited by time or nodes alone";
+    }
+    if (inputParser.cmdOptionExists("--prune"))
+    {
+        settings->setPruning(true);
+    }
+    if (inputParser.cmdOptionExists("--early-stop"))
+    {
+        settings->setEarlyStop(true);
+    }
+
+    // search on the opponent's time. A shared tree has no opponent's time to use: each side searches its own tree.
+    if (inputParser.cmdOptionExists("--ponder"))
+    {
+        settings->setPondering(true);
+        settings->setSharedTree(false);
+        LINFO << "Pondering uses a separate search tree per side";
+    }
+
+    // don't share the search tree between both sides in self-play
+    if (inputParser.cmdOptionExists("--separate-trees"))
+    {
+        settings->setSharedTree(false);
+    }
+
+    // set the opening tree
+    try
+    {
+        if (inputParser.cmdOptionExists("--opening-tree"))
+        {
+            settings->setOpeningTreePlies(std::stoi(inputParser.getCmdOption("--opening-tree")));
+        }
+    }
+    catch (std::invalid_argument const & e)
+    {
+        LFATAL << "Invalid amount of opening tree plies: " << e.what();
+    }
+
+    // log tree statistics once per move
+    if (inputParser.cmdOptionExists("--tree-stats"))
+    {
+        settings->setLogTreeStatistics(true);
+    }
+
     // set memory folder
     try
     {
@@ -86,6 +338,65 @@ void parseOptions(InputParser const & inputParser, std::shared_ptr<Settings> set
         LFATAL << "Invalid memory folder: " << e.what();
     }
 
+    // set persistent evaluation store
+    try
+    {
+        if (inputParser.cmdOptionExists("--eval-store"))
+        {
+            settings->setEvaluationStorePath(inputParser.getCmdOption("--eval-store"));
+        }
+        if (inputParser.cmdOptionExists("--eval-store-size"))
+        {
+            settings->setEvaluationStoreSize(std::stoi(inputParser.getCmdOption("--eval-store-size")));
+        }
+    }
+    catch (std::exception const & e)
+    {
+        LFATAL << "Invalid evaluation store setting: " << e.what();
+    }
+
+    // set the small model of the two-tier search
+    try
+    {
+        if (inputParser.cmdOptionExists("--small-model"))
+        {
+            settings->setSmallModelPath(inputParser.getCmdOption("--small-model"));
+        }
+        if (inputParser.cmdOptionExists("--small-filters"))
+        {
+            settings->setSmallModelFilters(std::stoi(inputParser.getCmdOption("--small-filters")));
+        }
+        if (inputParser.cmdOptionExists("--small-depth"))
+        {
+            settings->setSmallModelDepth(std::stoi(inputParser.getCmdOption("--small-depth")));
+        }
+        if (inputParser.cmdOptionExists("--small-visits"))
+        {
+            settings->setSmallModelVisits(std::stoi(inputParser.getCmdOption("--small-visits")));
+        }
+    }
+    catch (std::exception const & e)
+    {
+        LFATAL << "Invalid small model setting: " << e.what();
+    }
+
+    // set out-of-core node storage
+    try
+    {
+        if (inputParser.cmdOptionExists("--node-file"))
+        {
+            settings->setNodeStoragePath(inputParser.getCmdOption("--node-file"));
+        }
+        if (inputParser.cmdOptionExists("--node-file-size"))
+        {
+            settings->setNodeStorageSize(std::stoi(inputParser.getCmdOption("--node-file-size")));
+        }
+    }
+    catch (std::exception const & e)
+    {
+        LFATAL << "Invalid node storage setting: " << e.what();
+    }
+
     // set amount of pipeline games
     if (inputParser.cmdOptionExists("--pipeline"))
     {
@@ -141,6 +452,183 @@ void parseOptions(InputParser const & inputParser, std::shared_ptr<Settings> set
     }
 }
 
+/**
+ @brief Create distinct random openings of the given amount of moves, to start evaluation games from
+ */
+std::vector<std::vector<int>> createOpenings(int amount, int plies, int cols)
+{
+    // every sequence of columns is valid as long as no column can fill up
+    std::vector<std::vector<int>> openings = {{}};
+    for (int ply = 0; ply < plies; ply++)
+    {
+        std::vector<std::vector<int>> longer;
+        for (auto const & opening: openings)
+        {
+            for (int col = 0; col < cols; col++)
+            {
+                longer.push_back(opening);
+                longer.back().push_back(col);
+            }
+        }
+        openings = longer;
+    }
+    std::shuffle(openings.begin(), openings.end(), g_Generator);
+    openings.resize(std::min((size_t)amount, openings.size()));
+    return openings;
+}
+
+/**
+ @brief Return the average time in microseconds the network takes to evaluate the input
+ */
+double measureLatency(NeuralNetwork & net, torch::Tensor & input)
+{
+    int const warmup  = 5;
+    int const repeats = 20;
+    for (int i = 0; i < warmup; i++)
+    {
+        net.predict(input).second.sum().item<float>();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        // reading the output waits for the device to finish
+        net.predict(input).second.sum().item<float>();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+/**
+ @brief Log the latency of the eager and the scripted network at batch sizes 1 to 256
+ */
+void benchmarkInference(std::shared_ptr<Settings> settings)
+{
+    std::filesystem::path scriptedPath = settings->getScriptedModelPath();
+    settings->setScriptedModelPath("");
+    NeuralNetwork eager = NeuralNetwork(settings);
+    if (scriptedPath.empty())
+    {
+        scriptedPath = eager.exportScriptedModel(std::filesystem::temp_directory_path() / "benchmark_scripted.pt");
+    }
+    settings->setScriptedModelPath(scriptedPath);
+    NeuralNetwork scripted = NeuralNetwork(settings);
+    if (!scripted.isScripted())
+    {
+        LFATAL << "Could not load scripted model " << scriptedPath;
+    }
+
+    torch::NoGradGuard           noGrad;
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    LINFO << "Batch size | eager (us) | scripted (us) | speedup";
+    for (int batchSize = 1; batchSize <= 256; batchSize *= 2)
+    {
+        torch::Tensor input        = eager.boardToInput(env).repeat({batchSize, 1, 1, 1});
+        double        eagerTime    = measureLatency(eager, input);
+        double        scriptedTime = measureLatency(scripted, input);
+        LINFO << batchSize << " | " << eagerTime << " | " << scriptedTime << " | " << eagerTime / scriptedTime << "x";
+    }
+}
+
+/**
+ @brief Log the size, FLOPs and latency of a new network of every kind of residual block, with the configured depth and width
+ */
+void blockReport(std::shared_ptr<Settings> settings)
+{
+    settings->setScriptedModelPath("");
+    torch::NoGradGuard           noGrad;
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    LINFO << settings->getResidualBlocks() << " blocks of " << settings->getFilters() << " filters on a " << settings->getRows() << "x" << settings->getCols()
+          << " board";
+    LINFO << "Block type | parameters | MFLOPs per position | batch 1 (us) | batch 64 (us)";
+    for (eBlockType type: {eBlockType::RESIDUAL, eBlockType::BOTTLENECK, eBlockType::DEPTHWISE, eBlockType::DEPTHWISE_SE})
+    {
+        // goes through saving and loading, like a real model of this kind
+        std::filesystem::path path = std::filesystem::temp_directory_path() / ("block_report_" + blockTypeToString(type) + ".pt");
+        std::filesystem::remove(path);
+        settings->setBlockType(type);
+        settings->setModelPath(path);
+        NeuralNetwork net = NeuralNetwork(settings);
+
+        int64_t parameters = 0;
+        for (auto const & parameter: net.getNetwork()->parameters())
+        {
+            parameters += parameter.numel();
+        }
+        double        megaFlops = net.getNetwork()->countFlops(settings->getCols(), settings->getRows()) / 1e6;
+        torch::Tensor single    = net.boardToInput(env);
+        torch::Tensor batch     = single.repeat({64, 1, 1, 1});
+        LINFO << blockTypeToString(type) << " | " << parameters << " | " << megaFlops << " | " << measureLatency(net, single) << " | "
+              << measureLatency(net, batch);
+        std::filesystem::remove(path);
+    }
+}
+
+/**
+ @brief Search the root of a saved tree, or of an empty board if there is none, and save the tree afterwards.
+ A long analysis can be resumed by loading and saving the same file, and a precomputed tree can be copied to other machines.
+ */
+void analyseTree(std::shared_ptr<Settings> settings, std::filesystem::path const & loadPath, std::filesystem::path const & savePath)
+{
+    // an analysis looks for the best move, it doesn't need to explore
+    settings->setDirichletNoise(false);
+    std::shared_ptr<NeuralNetwork> model = std::make_shared<NeuralNetwork>(settings);
+    MCTS                           mcts(settings, nullptr, model);
+    if (!loadPath.empty() && !mcts.loadTree(loadPath))
+    {
+        LFATAL << "Could not load the search tree from " << loadPath;
+    }
+    mcts.getRoot()->getEnvironment()->print();
+    int const previousVisits = mcts.getRoot()->getVisits();
+
+    mcts.run_simulations(settings->getSimulations());
+    mcts.logTreeStatistics();
+    if (!mcts.getRoot()->getChildren().empty())
+    {
+        LINFO << "Best move: " << mcts.getBestMoveDeterministic() << " after " << mcts.getRoot()->getVisits() << " root visits, "
+              << mcts.getRoot()->getVisits() - previousVisits << " in this run";
+    }
+    if (!savePath.empty() && !mcts.saveTree(savePath))
+    {
+        LFATAL << "Could not save the search tree to " << savePath;
+    }
+}
+
+/**
+ @brief Log how closely the int8 network agrees with the fp32 network on positions of earlier games, and its speedup
+ */
+void quantizationReport(std::shared_ptr<Settings> settings)
+{
+    // int8 inference only runs on the CPU, so compare both there
+    settings->setuseCUDA(false);
+    settings->setScriptedModelPath("");
+    C4Dataset     dataset = C4Dataset(settings.get());
+    NeuralNetwork fp32    = NeuralNetwork(settings);
+    NeuralNetwork int8    = NeuralNetwork(settings);
+    if (!int8.quantize(dataset.sampleInputs(settings->getCalibrationSize())))
+    {
+        LFATAL << "Could not quantize model " << settings->getModelPath();
+    }
+
+    torch::NoGradGuard noGrad;
+    torch::Tensor      positions = dataset.sampleInputs(1024);
+    auto               expected  = fp32.predict(positions);
+    auto               actual    = int8.predict(positions);
+    float bestMoveAgreement = expected.first.argmax(1).eq(actual.first.argmax(1)).to(torch::kFloat32).mean().item<float>();
+    float policyDistance    = (expected.first - actual.first).abs().sum(1).mean().item<float>();
+    float valueError        = (expected.second - actual.second).abs().mean().item<float>();
+    LINFO << "Int8 vs fp32 on " << positions.size(0) << " positions: best move agreement " << 100 * bestMoveAgreement
+          << "%, mean policy L1 distance " << policyDistance << ", mean value error " << valueError;
+
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    LINFO << "Batch size | fp32 (us) | int8 (us) | speedup";
+    for (int batchSize = 1; batchSize <= 256; batchSize *= 2)
+    {
+        torch::Tensor input    = fp32.boardToInput(env).repeat({batchSize, 1, 1, 1});
+        double        fp32Time = measureLatency(fp32, input);
+        double        int8Time = measureLatency(int8, input);
+        LINFO << batchSize << " | " << fp32Time << " | " << int8Time << " | " << fp32Time / int8Time << "x";
+    }
+}
+
 /**
  @brief Return true if newer model is better
  */
@@ -148,16 +636,21 @@ bool evaluateModel(std::filesystem::path oldModel, std::filesystem::path newMode
 {
     int score                  = 0;
     int amountOfGamesPerPlayer = 10;
+    int openingPlies           = 2;
 
     std::shared_ptr<Settings> oldModelSettings = std::make_shared<Settings>();
     oldModelSettings->setSaveMemory(false);
     oldModelSettings->setSimulations(400);
     oldModelSettings->setStochastic(false);
+    oldModelSettings->setEarlyStop(true);
+    oldModelSettings->setDirichletNoise(false);
 
     std::shared_ptr<Settings> newModelSettings = std::make_shared<Settings>();
     newModelSettings->setSaveMemory(false);
     newModelSettings->setSimulations(400);
     newModelSettings->setStochastic(false);
+    newModelSettings->setEarlyStop(true);
+    newModelSettings->setDirichletNoise(false);
 
     // oldmodel starts as yellow, newmodel as red
     std::pair<std::shared_ptr<Agent>, std::shared_ptr<Agent>> agents;
@@ -169,10 +662,18 @@ bool evaluateModel(std::filesystem::path oldModel, std::filesystem::path newMode
 
     assert(agents.first->getName() == "OldAgent");
     assert(agents.second->getName() == "NewAgent");
+
+    // deterministic games from the same position are identical: start every game from a different opening,
+    // and don't search the positions that games reach again through another move order
+    std::vector<std::vector<int>> openings = createOpenings(amountOfGamesPerPlayer, openingPlies, oldModelSettings->getCols());
+    std::shared_ptr<SearchCache>  cache    = std::make_shared<SearchCache>();
+
     LINFO << "Evaluating " << oldModel << "as yellow vs " << newModel << " as red";
     for (int i = 0; i < amountOfGamesPerPlayer; i++)
     {
-        Game    match  = Game(oldModelSettings, agents);
+        Game match = Game(oldModelSettings, agents);
+        match.setOpening(openings[i % openings.size()]);
+        match.setSearchCache(cache);
         ePlayer result = match.playGame();
         if (result == ePlayer::YELLOW)
         {
@@ -192,7 +693,9 @@ bool evaluateModel(std::filesystem::path oldModel, std::filesystem::path newMode
     assert(agents.second->getName() == "OldAgent");
     for (int i = 0; i < amountOfGamesPerPlayer; i++)
     {
-        Game    match  = Game(oldModelSettings, agents);
+        Game match = Game(oldModelSettings, agents);
+        match.setOpening(openings[i % openings.size()]);
+        match.setSearchCache(cache);
         ePlayer result = match.playGame();
         if (result == ePlayer::YELLOW)
         {
@@ -204,13 +707,16 @@ bool evaluateModel(std::filesystem::path oldModel, std::filesystem::path newMode
             score--;
         }
     }
+    cache->logStatistics();
 
     return score > 0;
 }
 
-void runGame(std::shared_ptr<Settings> settings, std::shared_ptr<Agent> yellow, std::shared_ptr<Agent> red, SelfPlayTally & tally)
+void runGame(std::shared_ptr<Settings> settings, std::shared_ptr<Agent> yellow, std::shared_ptr<Agent> red, SelfPlayTally & tally,
+             std::shared_ptr<OpeningTree> openingTree)
 {
-    Game    game   = Game(settings, std::pair(yellow, red));
+    Game game = Game(settings, std::pair(yellow, red));
+    game.setOpeningTree(openingTree);
     ePlayer winner = game.playGame();
     if (winner == ePlayer::NONE)
     {
@@ -233,13 +739,14 @@ void runGame(std::shared_ptr<Settings> settings, std::shared_ptr<Agent> yellow,
     LINFO << "\n\n\n";
 }
 
-void runPipeline(std::shared_ptr<Settings> settings, std::shared_ptr<Agent> yellow, std::shared_ptr<Agent> red, SelfPlayTally & tally)
+void runPipeline(std::shared_ptr<Settings> settings, std::shared_ptr<Agent> yellow, std::shared_ptr<Agent> red, SelfPlayTally & tally,
+                 std::shared_ptr<OpeningTree> openingTree)
 {
     LINFO << "Running selfplay...";
     for (int gameCount = 1; gameCount <= settings->getPipelineGames(); gameCount++)
     {
         LINFO << "\n\n\tStarting game " << gameCount << "...\n";
-        runGame(settings, yellow, red, tally);
+        runGame(settings, yellow, red, tally, openingTree);
     }
 
     // train with these games
@@ -329,6 +836,41 @@ int main(int argc, char * argv[])
     std::shared_ptr<Settings> settings = std::make_shared<Settings>();
     parseOptions(inputParser, settings);
 
+    if (!settings->getNodeStoragePath().empty())
+    {
+        // must happen before the first tree is created
+        NodeStorage::setActive(std::make_shared<NodeStorage>(settings->getNodeStoragePath(), (size_t)settings->getNodeStorageSize() << 30));
+    }
+
+    if (inputParser.cmdOptionExists("--export-script"))
+    {
+        settings->setScriptedModelPath("");
+        NeuralNetwork(settings).exportScriptedModel(inputParser.getCmdOption("--export-script"));
+        return 0;
+    }
+    if (inputParser.cmdOptionExists("--benchmark"))
+    {
+        benchmarkInference(settings);
+        return 0;
+    }
+    if (inputParser.cmdOptionExists("--block-report"))
+    {
+        blockReport(settings);
+        return 0;
+    }
+    if (inputParser.cmdOptionExists("--quantization-report"))
+    {
+        quantizationReport(settings);
+        return 0;
+    }
+    if (inputParser.cmdOptionExists("--load-tree") || inputParser.cmdOptionExists("--save-tree"))
+    {
+        std::filesystem::path loadPath = inputParser.cmdOptionExists("--load-tree") ? inputParser.getCmdOption("--load-tree") : "";
+        std::filesystem::path savePath = inputParser.cmdOptionExists("--save-tree") ? inputParser.getCmdOption("--save-tree") : "";
+        analyseTree(settings, loadPath, savePath);
+        return 0;
+    }
+
     // TODO: load all settings from a json file or something
     if (inputParser.cmdOptionExists("--train"))
     {
@@ -346,13 +888,57 @@ int main(int argc, char * argv[])
         std::shared_ptr<Agent>         player1 = std::make_shared<Agent>("yellow", model, settings);
         std::shared_ptr<Agent>         player2 = std::make_shared<Agent>("red", model, settings);
 
+        std::shared_ptr<InferenceServer> server = nullptr;
+        if (settings->getInferenceBatchSize() > 0)
+        {
+            // one server thread runs the network for every search thread
+            server      = std::make_shared<InferenceServer>(settings->getInferenceBatchSize(), std::chrono::microseconds(settings->getInferenceWait()));
+            int modelId = server->addModel(model);
+            player1->getMCTS()->setInferenceServer(server, modelId);
+            player2->getMCTS()->setInferenceServer(server, modelId);
+        }
+
+        std::shared_ptr<NeuralNetwork> smallModel = nullptr;
+        if (!settings->getSmallModelPath().empty())
+        {
+            // two-tier search: the small model evaluates the less important leaves
+            smallModel = std::make_shared<NeuralNetwork>(settings, settings->getSmallModelPath(), settings->getSmallModelFilters());
+            player1->getMCTS()->setSmallNetwork(smallModel);
+            player2->getMCTS()->setSmallNetwork(smallModel);
+        }
+
+        if (settings->useQuantizedInference())
+        {
+            // int8 inference, calibrated on the positions of earlier games
+            try
+            {
+                torch::Tensor calibration = C4Dataset(settings.get()).sampleInputs(settings->getCalibrationSize());
+                model->quantize(calibration);
+                if (smallModel != nullptr)
+                {
+                    smallModel->quantize(calibration);
+                }
+            }
+            catch (std::exception const & e)
+            {
+                LWARN << "No positions to calibrate the int8 network, keeping fp32: " << e.what();
+            }
+        }
+
+        // the opening tree is rebuilt by itself when the model changes
+        std::shared_ptr<OpeningTree> openingTree = nullptr;
+        if (settings->getOpeningTreePlies() > 0)
+        {
+            openingTree = std::make_shared<OpeningTree>(settings->getOpeningTreePlies(), settings->getRows(), settings->getCols());
+        }
+
         if (inputParser.cmdOptionExists("--pipeline"))
         {
             // run full pipeline with selfplay & training
             LINFO << "Running full pipeline with " << settings->getPipelineGames() << " games...";
             while (g_Running)
             {
-                runPipeline(settings, player1, player2, tally);
+                runPipeline(settings, player1, player2, tally, openingTree);
             }
         }
         else
@@ -360,7 +946,7 @@ int main(int argc, char * argv[])
             // run games infinitely
             while (g_Running)
             {
-                runGame(settings, player1, player2, tally);
+                runGame(settings, player1, player2, tally, openingTree);
             }
         }
     }
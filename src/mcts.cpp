@@ -3,6 +3,7 @@
 MCTS::MCTS(std::shared_ptr<Settings> settings, std::unique_ptr<Node> root, std::shared_ptr<NeuralNetwork> const & nn)
   : m_Settings(settings)
   , m_NN(nn)
+  , m_Generator(g_Generator())
 {
 
     if (root == nullptr)
@@ -19,6 +20,7 @@ MCTS::MCTS(std::shared_ptr<Settings> settings, std::unique_ptr<Node> root, std::
 }
 
 MCTS::~MCTS() {
+    stopPondering();
     LDEBUG << "Destroying MCTS";
 }
 
@@ -29,6 +31,19 @@ std::unique_ptr<Node> const & MCTS::getRoot() const
 
 void MCTS::setRoot(Node * newRoot)
 {
+    // the pondering thread must not walk the tree while it changes
+    stopPondering();
+
+    // counting the kept subtree walks all of it, so only when something needs the count
+    int const reusedNodes = countsNodes() ? countNodes(newRoot) : 1;
+    m_ReusedFraction      = m_Settings->logTreeStatistics() && m_NodeCount > 0 ? (float)reusedNodes / (float)m_NodeCount : 0.0f;
+    m_NodeCount           = reusedNodes;
+    m_FullEvaluations     = 0;
+    m_SmallEvaluations = 0;
+
+    // a compact node that was never visited only has its environment through its parent, which is about to be deleted
+    newRoot->getEnvironment();
+
     // release the child from previousNode where child == newroot
     Node * previousNode = newRoot->getParent();
     for (auto const & child: previousNode->getChildren())
@@ -50,32 +65,47 @@ void MCTS::setRoot(Node * newRoot)
 
 void MCTS::setRoot(std::unique_ptr<Node> newRoot)
 {
+    stopPondering();
+
+    // a completely new tree: nothing of the previous tree is reused
+    m_ReusedFraction   = 0.0f;
+    m_FullEvaluations  = 0;
+    m_SmallEvaluations = 0;
+    m_NodeCount        = countsNodes() ? countNodes(newRoot.get()) : 1;
     m_Root = std::move(newRoot);
+    m_Root->getEnvironment();
     m_Root->setParent(nullptr);
 }
 
 void MCTS::addDirichletNoise(Node * root)
 {
-    if (root->getParent() == nullptr)
+    if (root->getParent() != nullptr)
     {
-        auto input  = m_NN->boardToInput(root->getEnvironment());
-        auto output = m_NN->predict(input);
-        auto policy = output.first.view({7});
-        // root node, add dirichlet noise to policy
-        auto noise = utils::calculateDirichletNoise(policy);
-        float frac = 0.40;
-        for (int i = 0; i < policy.size(0); i++)
-        {
-            std::stringstream ss;
-            ss << "Prior " << i << ": " << policy[i].item<float>();
-            root->setPrior((policy[i] * (1 - frac) + noise[i] * frac).item<float>());
-            ss << "\t => \t" << root->getPrior();
-            LDEBUG << ss.str();
-        }
+        LFATAL << "Root has parent, this shouldn't be the case when adding dirichlet noise";
     }
-    else
+
+    // the noise goes on the priors of the root's children, so the root needs to be expanded first
+    if (root->getChildren().empty())
     {
-        LFATAL << "Root has parent, this shouldn't be the case when adding dirichlet noise";
+        float result = expand(root);
+        backpropagate(root, result);
+    }
+    Node::Children const & children = root->getChildren();
+    if (children.empty())
+    {
+        return;
+    }
+
+    std::vector<float> priors;
+    for (auto const & child: children)
+    {
+        priors.push_back(child->getPrior());
+    }
+    std::vector<float> noisyPriors = utils::calculateDirichletNoise(priors, m_Generator);
+    for (int i = 0; i < (int)children.size(); i++)
+    {
+        LDEBUG << "Prior " << children[i]->getMove() << ": " << priors[i] << "\t => \t" << noisyPriors[i];
+        children[i]->setPrior(noisyPriors[i]);
     }
 }
 
@@ -83,14 +113,86 @@ void MCTS::run_simulations(int simulations)
 {
     Node* root = getRoot().get();
 
-    // TODO: only add this in selfplay
-    addDirichletNoise(root);
+    int const maxTime  = m_Settings->getSearchTime();
+    int const maxNodes = m_Settings->getSearchNodes();
+    if (simulations <= 0 && maxTime <= 0 && maxNodes <= 0)
+    {
+        LFATAL << "No search limit: set an amount of simulations, a search time or a node budget";
+    }
+
+    if (m_Settings->useDirichletNoise() && m_Exploration)
+    {
+        addDirichletNoise(root);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (simulations > 0)
+    {
+        LINFO << "Running " << simulations << " simulations...\n";
+    }
+    else
+    {
+        LINFO << "Running simulations until the search budget is used...\n";
+    }
+    // adaptive simulations: the distribution of the visits this search added, at the last convergence check.
+    // A reused root brings the visits of earlier searches, which would hide how much this search still moves.
+    std::vector<int>   startVisits          = getRootVisits();
+    std::vector<float> previousDistribution = getRootVisitDistribution(startVisits);
+    int                convergedChecks      = 0;
+    int const          interval             = m_Settings->getConvergenceInterval();
 
-    LINFO << "Running " << simulations << " simulations...\n";
     tqdm bar;
-    for (int i = 0; i < simulations && g_Running; i++)
+    int  i = 0;
+    for (; (simulations <= 0 || i < simulations) && g_Running; i++)
     {
-        bar.progress(i, simulations);
+        if (!enforceNodeBudget())
+        {
+            LDEBUG << "Node budget of " << maxNodes << " reached";
+            break;
+        }
+
+        int elapsed = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        if (maxTime > 0 && elapsed >= maxTime)
+        {
+            LDEBUG << "Search time of " << maxTime << "ms reached";
+            break;
+        }
+
+        if (root->isProven())
+        {
+            LDEBUG << "Root position solved after " << i << " simulations";
+            break;
+        }
+
+        // only a fixed amount of simulations bounds the ones still to come: a time limit is no bound,
+        // the search may speed up (e.g. through stored evaluations), so a time-only search never stops early
+        if (m_Settings->useEarlyStop() && simulations > 0)
+        {
+            if (isSearchSettled(simulations - i))
+            {
+                LDEBUG << "Search settled after " << i << " simulations";
+                break;
+            }
+        }
+
+        if (m_Settings->useAdaptiveSimulations() && i > 0 && i % interval == 0)
+        {
+            std::vector<float> distribution = getRootVisitDistribution(startVisits);
+            float              divergence   = utils::klDivergence(distribution, previousDistribution);
+            previousDistribution            = distribution;
+            convergedChecks                 = divergence < m_Settings->getConvergenceThreshold() ? convergedChecks + 1 : 0;
+            if (convergedChecks >= convergenceChecks)
+            {
+                LDEBUG << "Root visits converged after " << i << " simulations (KL divergence " << divergence << ")";
+                break;
+            }
+        }
+
+        if (simulations > 0 && m_ShowProgress)
+        {
+            bar.progress(i, simulations);
+        }
         // step 1: selection
         Node * selected = select(root);
         // step 2 and 3: expansion and evaluation
@@ -98,21 +200,665 @@ void MCTS::run_simulations(int simulations)
         // step 4: backpropagation
         backpropagate(selected, result);
     }
-    // std::cout << "Tree depth: " << MCTS::getTreeDepth(root);
     std::cout << std::endl;
+    m_SimulationsUsed = i;
+    LDEBUG << "Ran " << i << " simulations in "
+           << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << "ms";
+}
+
+void MCTS::run_gumbel(int simulations)
+{
+    // sequential halving splits a fixed amount of simulations over its phases
+    if (simulations <= 0)
+    {
+        LFATAL << "Gumbel search needs an amount of simulations, a time or node budget alone is not enough";
+    }
+
+    Node * root = m_Root.get();
+    if (root->getChildren().empty())
+    {
+        float result = expand(root);
+        backpropagate(root, result);
+        simulations--;
+    }
+    Node::Children const & children = root->getChildren();
+    int const              actions  = (int)children.size();
+    m_GumbelLogits.assign(actions, 0.0f);
+    m_GumbelCandidates.clear();
+    if (actions == 0)
+    {
+        return;
+    }
+
+    // gumbel-top-k: sample k moves without replacement. Deterministic play keeps only the logits.
+    std::extreme_value_distribution<float> gumbelDist(0.0f, 1.0f);
+    for (int i = 0; i < actions; i++)
+    {
+        float gumbel      = m_Settings->isStochastic() ? gumbelDist(m_Generator) : 0.0f;
+        m_GumbelLogits[i] = gumbel + std::log(std::max(children[i]->getPrior(), 1e-8f));
+    }
+    std::vector<int> candidates(actions);
+    std::iota(candidates.begin(), candidates.end(), 0);
+    std::sort(candidates.begin(), candidates.end(), [&](int a, int b) { return m_GumbelLogits[a] > m_GumbelLogits[b]; });
+    candidates.resize(std::min(actions, m_Settings->getGumbelActions()));
+
+    LINFO << "Running " << simulations << " simulations with sequential halving over " << candidates.size() << " moves...\n";
+    int const phases  = std::max(1, (int)std::ceil(std::log2((float)candidates.size())));
+    int const maxTime = m_Settings->getSearchTime();
+    auto      start   = std::chrono::steady_clock::now();
+    int       used    = 0;
+    // the time and node budgets stop the search early, like in run_simulations
+    bool withinBudget = true;
+    auto checkBudget  = [&]() {
+        int elapsed  = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        withinBudget = (maxTime <= 0 || elapsed < maxTime) && enforceNodeBudget();
+        return withinBudget;
+    };
+    for (int phase = 0; phase < phases && used < simulations && withinBudget && g_Running && !root->isProven(); phase++)
+    {
+        // spread the budget evenly over the phases, and over the moves in each phase
+        int visitsPerMove = std::max(1, simulations / (phases * (int)candidates.size()));
+        if (phase == phases - 1)
+        {
+            // the last phase gets whatever is left
+            visitsPerMove = std::max(1, (simulations - used) / (int)candidates.size());
+        }
+        for (int visit = 0; visit < visitsPerMove && withinBudget; visit++)
+        {
+            for (int candidate: candidates)
+            {
+                if (used >= simulations || !checkBudget())
+                {
+                    break;
+                }
+                Node * selected = select(children[candidate].get());
+                float  result   = expand(selected);
+                backpropagate(selected, result);
+                used++;
+            }
+        }
+
+        // keep the best half
+        std::vector<float> completedQ = getCompletedQ();
+        std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+            return m_GumbelLogits[a] + sigma(completedQ[a]) > m_GumbelLogits[b] + sigma(completedQ[b]);
+        });
+        if (phase < phases - 1)
+        {
+            candidates.resize((candidates.size() + 1) / 2);
+        }
+    }
+    m_GumbelCandidates = candidates;
+    LDEBUG << "Ran " << used << " gumbel simulations";
+}
+
+int MCTS::getGumbelMove() const
+{
+    // always play a proven win
+    if (Node * winningChild = getWinningChild())
+    {
+        return winningChild->getMove();
+    }
+    if (m_GumbelCandidates.empty())
+    {
+        LFATAL << "No gumbel candidates: run_gumbel() must be called first";
+    }
+
+    std::vector<float> completedQ = getCompletedQ();
+    int                best       = m_GumbelCandidates.front();
+    for (int candidate: m_GumbelCandidates)
+    {
+        if (m_GumbelLogits[candidate] + sigma(completedQ[candidate]) > m_GumbelLogits[best] + sigma(completedQ[best]))
+        {
+            best = candidate;
+        }
+    }
+    return m_Root->getChildren().at(best)->getMove();
+}
+
+std::vector<float> MCTS::getImprovedPolicy() const
+{
+    Node::Children const & children   = m_Root->getChildren();
+    std::vector<float>     completedQ = getCompletedQ();
+    std::vector<float>     policy     = std::vector<float>(m_Settings->getCols(), 0.0f);
+
+    // softmax over logits + sigma(completed q), without the gumbel noise
+    std::vector<float> scores;
+    for (int i = 0; i < (int)children.size(); i++)
+    {
+        scores.push_back(std::log(std::max(children[i]->getPrior(), 1e-8f)) + sigma(completedQ[i]));
+    }
+    float maxScore = *std::max_element(scores.begin(), scores.end());
+    float sum      = 0.0f;
+    for (float & score: scores)
+    {
+        score = std::exp(score - maxScore);
+        sum += score;
+    }
+    for (int i = 0; i < (int)children.size(); i++)
+    {
+        policy[children[i]->getMove()] = scores[i] / sum;
+    }
+    return policy;
+}
+
+std::vector<float> MCTS::getCompletedQ() const
+{
+    Node::Children const & children = m_Root->getChildren();
+
+    // the children's values are seen from the root's player, the root's own value from the opponent
+    float rootValue     = -m_Root->getQ();
+    int   visits        = 0;
+    float visitedPrior  = 0.0f;
+    float weightedValue = 0.0f;
+    for (auto const & child: children)
+    {
+        if (child->getVisits() > 0)
+        {
+            visits += child->getVisits();
+            visitedPrior += child->getPrior();
+            weightedValue += child->getPrior() * child->getQ();
+        }
+    }
+    float mixedValue = rootValue;
+    if (visits > 0 && visitedPrior > 0.0f)
+    {
+        mixedValue = (rootValue + (float)visits * weightedValue / visitedPrior) / (1.0f + (float)visits);
+    }
+
+    std::vector<float> completedQ;
+    for (auto const & child: children)
+    {
+        float q = child->isProven() ? child->getProvenValue() : child->getVisits() > 0 ? child->getQ() : mixedValue;
+        // from [-1, 1] to [0, 1]
+        completedQ.push_back((std::clamp(q, -1.0f, 1.0f) + 1.0f) / 2.0f);
+    }
+    return completedQ;
+}
+
+float MCTS::sigma(float q) const
+{
+    int maxVisits = 0;
+    for (auto const & child: m_Root->getChildren())
+    {
+        maxVisits = std::max(maxVisits, child->getVisits());
+    }
+    return (cvisit + (float)maxVisits) * cscale * q;
+}
+
+void MCTS::run_batched(int simulations)
+{
+    if (m_Settings->useDirichletNoise() && m_Exploration)
+    {
+        addDirichletNoise(m_Root.get());
+    }
+    BatchEvaluator evaluator(m_NN, m_Settings->getSearchBatchSize(), std::chrono::microseconds(m_Settings->getBatchTimeout()));
+    LINFO << "Running " << simulations << " simulations in batches of " << evaluator.getBatchSize() << "...\n";
+    run_batched({this}, simulations, evaluator);
+    evaluator.logStatistics();
+}
+
+void MCTS::run_batched(std::vector<MCTS *> const & trees, int simulations, BatchEvaluator & evaluator)
+{
+    std::vector<int>            started(trees.size(), 0);
+    std::vector<SimulationTask> inFlight;
+    // trees whose selection ran into a leaf of this batch: they wait for the next batch
+    std::vector<bool> collided(trees.size(), false);
+
+    // a tree can start a new simulation if it has budget left, and the next expansions still fit in its node budget
+    auto canStart = [&](int tree) {
+        MCTS const * mcts     = trees[tree];
+        int const    maxNodes = mcts->m_Settings->getSearchNodes();
+        if (collided[tree] || started[tree] >= simulations || mcts->m_Root->isProven())
+        {
+            return false;
+        }
+        return maxNodes <= 0 || mcts->m_NodeCount + mcts->m_Settings->getCols() * (evaluator.getPending() + 1) <= maxNodes;
+    };
+
+    while (g_Running)
+    {
+        // fill the batch round-robin, until it is full or no tree can start a simulation anymore
+        std::fill(collided.begin(), collided.end(), false);
+        bool anyStarted  = true;
+        bool anyCollided = false;
+        while (anyStarted && !evaluator.shouldFlush())
+        {
+            anyStarted = false;
+            for (int tree = 0; tree < (int)trees.size() && !evaluator.shouldFlush(); tree++)
+            {
+                if (!canStart(tree))
+                {
+                    continue;
+                }
+                MCTS * mcts = trees[tree];
+                // step 1: selection
+                Node * leaf = mcts->select(mcts->m_Root.get());
+                if (mcts->m_PendingLeaves.contains(leaf))
+                {
+                    // evaluating the leaf twice would use up a simulation without adding to the tree:
+                    // don't count it, the tree selects again once the leaf is expanded
+                    evaluator.recordCollision();
+                    collided[tree] = true;
+                    anyCollided    = true;
+                    continue;
+                }
+                inFlight.emplace_back(mcts->simulate(leaf, evaluator));
+                started[tree]++;
+                anyStarted = true;
+            }
+        }
+
+        // every simulation in flight is now waiting for the network
+        evaluator.flush();
+        std::erase_if(inFlight, [](SimulationTask const & task) { return task.done(); });
+        if (inFlight.empty() && !anyStarted && !anyCollided)
+        {
+            break;
+        }
+    }
+    // the trees may change after this search, so their nodes must not be evaluated anymore
+    evaluator.clearSpeculative();
+    for (MCTS * mcts: trees)
+    {
+        // only left over if the search was interrupted
+        mcts->m_PendingLeaves.clear();
+    }
+}
+
+SimulationTask MCTS::simulate(Node * leaf, BatchEvaluator & evaluator)
+{
+    std::optional<float> exactValue = getExactValue(leaf);
+    if (exactValue.has_value())
+    {
+        backpropagate(leaf, exactValue.value());
+        co_return;
+    }
+
+    // the leaf may already have been evaluated speculatively: no need to wait for the network
+    if (leaf->hasEvaluation())
+    {
+        evaluator.recordSpeculativeHit();
+        auto [policy, speculativeValue] = leaf->takeEvaluation();
+        float value                     = addChildren(leaf, policy.view({7}), speculativeValue);
+        speculateChildren(leaf, evaluator);
+        backpropagate(leaf, value);
+        co_return;
+    }
+
+    // a position evaluated in an earlier run doesn't need the network either
+    std::optional<std::pair<torch::Tensor, float>> stored = m_NN->lookupEvaluation(leaf->getEnvironment());
+    if (stored.has_value())
+    {
+        float value = addChildren(leaf, stored->first, stored->second);
+        speculateChildren(leaf, evaluator);
+        backpropagate(leaf, value);
+        co_return;
+    }
+
+    // step 3: evaluation, together with the leaves of other simulations
+    applyVirtualLoss(leaf, 1);
+    m_PendingLeaves.insert(leaf);
+    Evaluation evaluation = co_await evaluator.evaluate(m_NN->boardToInput(leaf->getEnvironment()));
+    m_PendingLeaves.erase(leaf);
+    applyVirtualLoss(leaf, -1);
+    m_NN->storeEvaluation(leaf->getEnvironment(), evaluation.policy, evaluation.value);
+
+    // step 2: expansion
+    float value = evaluation.value;
+    if (leaf->getChildren().empty())
+    {
+        value = addChildren(leaf, evaluation.policy, evaluation.value);
+        speculateChildren(leaf, evaluator);
+    }
+    // step 4: backpropagation
+    backpropagate(leaf, value);
+}
+
+void MCTS::speculateChildren(Node * node, BatchEvaluator & evaluator)
+{
+    int const amount = std::min(m_Settings->getSpeculativeChildren(), (int)node->getChildren().size());
+    if (amount <= 0)
+    {
+        return;
+    }
+
+    // the children with the highest priors are the most likely to be selected next
+    std::vector<Node *> children;
+    for (auto const & child: node->getChildren())
+    {
+        children.push_back(child.get());
+    }
+    std::partial_sort(children.begin(), children.begin() + amount, children.end(),
+                      [](Node const * a, Node const * b) { return a->getPrior() > b->getPrior(); });
+    for (int i = 0; i < amount; i++)
+    {
+        if (!children[i]->hasEvaluation())
+        {
+            evaluator.speculate(children[i], m_NN->boardToInput(children[i]->getEnvironment()));
+        }
+    }
+}
+
+void MCTS::applyVirtualLoss(Node * leaf, int amount)
+{
+    // count a loss for every player that moved along the path, so selection avoids it
+    for (Node * current = leaf; current != nullptr && current->getParent() != nullptr; current = current->getParent())
+    {
+        current->addVisits(amount);
+        current->setValue(current->getValue() - (float)amount);
+    }
+}
+
+void MCTS::run_root_parallel(int simulations, int searches)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // every helper searches a copy of the root position with its own noise,
+    // even if this tree doesn't use any. Searches without exploration have no noise at all.
+    std::shared_ptr<Settings> helperSettings = std::make_shared<Settings>(*m_Settings);
+    helperSettings->setDirichletNoise(true);
+    std::vector<std::unique_ptr<MCTS>> helpers;
+    for (int i = 1; i < searches; i++)
+    {
+        std::shared_ptr<Environment> env = std::make_shared<Environment>(m_Root->getEnvironment());
+        helpers.emplace_back(std::make_unique<MCTS>(helperSettings, std::make_unique<Node>(env), m_NN));
+        helpers.back()->setShowProgress(false);
+        helpers.back()->setExploration(m_Exploration);
+        helpers.back()->setSmallNetwork(m_SmallNN);
+        helpers.back()->setInferenceServer(m_InferenceServer, m_ServerModel);
+    }
+
+    std::vector<std::thread> threads;
+    for (auto & helper: helpers)
+    {
+        threads.emplace_back([&helper, simulations]() {
+            // gradients are disabled per thread
+            torch::NoGradGuard noGrad;
+            helper->run_simulations(simulations);
+        });
+    }
+    run_simulations(simulations);
+    for (auto & thread: threads)
+    {
+        thread.join();
+    }
+
+    TreeStatistics stats = getTreeStatistics();
+    for (auto const & helper: helpers)
+    {
+        mergeRootStatistics(*helper);
+        TreeStatistics helperStats = helper->getTreeStatistics();
+        stats.nodes += helperStats.nodes;
+        stats.bytesUsed += helperStats.bytesUsed;
+    }
+
+    int   elapsed = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    float speed   = elapsed > 0 ? 1000.0f * (float)m_Root->getVisits() / (float)elapsed : 0.0f;
+    LINFO << "Root-parallel search: " << searches << " trees, " << m_Root->getVisits() << " root visits in " << elapsed << "ms (" << speed
+          << " visits/s), " << stats.nodes << " nodes, " << stats.bytesUsed / 1024 << " KiB";
+}
+
+void MCTS::mergeRootStatistics(MCTS const & other)
+{
+    int visits = 0;
+    for (auto const & otherChild: other.getRoot()->getChildren())
+    {
+        Node * child = m_Root->getChildAfterMove(otherChild->getMove());
+        if (child == nullptr)
+        {
+            LWARN << "Can't merge move " << otherChild->getMove() << ": it is not in this tree";
+            continue;
+        }
+        child->addVisits(otherChild->getVisits());
+        child->setValue(child->getValue() + otherChild->getValue());
+        if (!child->isProven() && otherChild->isProven())
+        {
+            // both children are the same position, so the proof holds here too
+            child->setProof(otherChild->getProof());
+            propagateProof(child);
+        }
+        visits += otherChild->getVisits();
+    }
+    m_Root->addVisits(visits);
+}
+
+void MCTS::startPondering()
+{
+    if (isPondering())
+    {
+        LWARN << "Already pondering";
+        return;
+    }
+    m_StopPondering = false;
+    m_PonderThread  = std::thread(&MCTS::ponder, this);
+}
+
+void MCTS::stopPondering()
+{
+    if (!isPondering())
+    {
+        return;
+    }
+    m_StopPondering = true;
+    m_PonderThread.join();
+}
+
+bool MCTS::isPondering() const
+{
+    return m_PonderThread.joinable();
+}
+
+void MCTS::ponder()
+{
+    // gradients are disabled per thread
+    torch::NoGradGuard noGrad;
+
+    Node * root = m_Root.get();
+    int    i    = 0;
+    while (!m_StopPondering && g_Running && !root->isProven() && enforceNodeBudget())
+    {
+        Node * selected = select(root);
+        float  result   = expand(selected);
+        backpropagate(selected, result);
+        i++;
+    }
+    LDEBUG << "Pondered " << i << " simulations";
+}
+
+bool MCTS::enforceNodeBudget()
+{
+    int const maxNodes = m_Settings->getSearchNodes();
+    // an expansion adds at most one child per column
+    int const maxNewNodes = m_Settings->getCols();
+    if (maxNodes <= 0 || m_NodeCount + maxNewNodes <= maxNodes)
+    {
+        return true;
+    }
+    if (!m_Settings->usePruning())
+    {
+        return false;
+    }
+    pruneTree(maxNodes * 3 / 4);
+    return m_NodeCount + maxNewNodes <= maxNodes;
+}
+
+void MCTS::pruneTree(int targetNodes)
+{
+    // every expanded node below the root can be collapsed
+    std::vector<Node *> candidates;
+    std::vector<Node *> stack = {m_Root.get()};
+    while (!stack.empty())
+    {
+        Node * current = stack.back();
+        stack.pop_back();
+        for (auto const & child: current->getChildren())
+        {
+            if (!child->getChildren().empty())
+            {
+                candidates.push_back(child.get());
+                stack.push_back(child.get());
+            }
+        }
+    }
+
+    // least visited subtrees first. Collapsing a node that was already recycled
+    // as part of a larger subtree is harmless: it has no children left.
+    std::stable_sort(candidates.begin(), candidates.end(), [](Node const * a, Node const * b) { return a->getVisits() < b->getVisits(); });
+    int const before = m_NodeCount;
+    for (Node * candidate: candidates)
+    {
+        if (m_NodeCount <= targetNodes)
+        {
+            break;
+        }
+        recycleChildren(candidate);
+    }
+    LDEBUG << "Pruned tree from " << before << " to " << m_NodeCount << " nodes, " << m_FreeNodes.size() << " free nodes";
+}
+
+int MCTS::recycleChildren(Node * node)
+{
+    int                                recycled = 0;
+    std::vector<std::unique_ptr<Node>> released;
+    node->releaseChildren(released);
+    while (!released.empty())
+    {
+        std::unique_ptr<Node> current = std::move(released.back());
+        released.pop_back();
+        current->releaseChildren(released);
+        // drop the environment now, the node will get a new one when it is reused
+        current->reset(nullptr, nullptr, -1, 0.0f);
+        m_FreeNodes.emplace_back(std::move(current));
+        recycled++;
+    }
+    m_NodeCount -= recycled;
+    return recycled;
+}
+
+std::unique_ptr<Node> MCTS::acquireNode(Node * parent, std::shared_ptr<Environment> env, int move, float prior)
+{
+    if (m_FreeNodes.empty())
+    {
+        return std::make_unique<Node>(parent, std::move(env), move, prior);
+    }
+    std::unique_ptr<Node> node = std::move(m_FreeNodes.back());
+    m_FreeNodes.pop_back();
+    node->reset(parent, std::move(env), move, prior);
+    return node;
+}
+
+bool MCTS::saveTree(std::filesystem::path const & path)
+{
+    // the pondering thread must not change the tree while it is written
+    stopPondering();
+    return treeSnapshot::save(m_Root.get(), path);
+}
+
+bool MCTS::loadTree(std::filesystem::path const & path)
+{
+    std::unique_ptr<Node> root = treeSnapshot::load(path);
+    if (root == nullptr)
+    {
+        return false;
+    }
+    setRoot(std::move(root));
+    return true;
+}
+
+void MCTS::setShowProgress(bool showProgress)
+{
+    m_ShowProgress = showProgress;
+}
+
+void MCTS::setExploration(bool exploration)
+{
+    m_Exploration = exploration;
+}
+
+void MCTS::setSmallNetwork(std::shared_ptr<NeuralNetwork> smallNN)
+{
+    m_SmallNN = smallNN;
+}
+
+void MCTS::setInferenceServer(std::shared_ptr<InferenceServer> server, int model)
+{
+    m_InferenceServer = server;
+    m_ServerModel     = model;
+}
+
+std::vector<int> MCTS::getRootVisits() const
+{
+    std::vector<int> visits(m_Settings->getCols(), 0);
+    for (auto const & child: m_Root->getChildren())
+    {
+        visits[child->getMove()] = child->getVisits();
+    }
+    return visits;
+}
+
+std::vector<float> MCTS::getRootVisitDistribution(std::vector<int> const & baseline) const
+{
+    std::vector<int> visits = getRootVisits();
+    for (int i = 0; i < (int)baseline.size(); i++)
+    {
+        visits[i] -= baseline[i];
+    }
+    std::vector<float> distribution(visits.size(), 0.0f);
+    int const          total = std::accumulate(visits.begin(), visits.end(), 0);
+    if (total <= 0)
+    {
+        return distribution;
+    }
+    for (int i = 0; i < (int)visits.size(); i++)
+    {
+        distribution[i] = (float)visits[i] / (float)total;
+    }
+    return distribution;
+}
+
+int MCTS::getSimulationsUsed() const
+{
+    return m_SimulationsUsed;
+}
+
+bool MCTS::isSearchSettled(int remainingSimulations) const
+{
+    // every simulation adds exactly one visit to one of the root's children
+    int most   = 0;
+    int second = 0;
+    for (auto const & child: m_Root->getChildren())
+    {
+        int visits = child->getVisits();
+        if (visits > most)
+        {
+            second = most;
+            most   = visits;
+        }
+        else if (visits > second)
+        {
+            second = visits;
+        }
+    }
+    return most > 0 && most - second > remainingSimulations;
 }
 
 Node * MCTS::select(Node* root)
 {
     // keep selecting nodes using the Q+U formula
-    // until we reach a node not yet expanded
+    // until we reach a node not yet expanded, or a node with a known result
     Node * current = root;
-    while (current->getChildren().size() > 0)
+    while (current->getChildren().size() > 0 && !current->isProven())
     {
         Node * best_child = nullptr;
         float  best_score = -2;
         for (auto & child: current->getChildren())
         {
+            if (child->getProof() == eProof::LOSS)
+            {
+                // never search a move that is proven to lose
+                continue;
+            }
             float score = child->getQ() + child->getU();
             if (score > best_score)
             {
@@ -131,51 +877,195 @@ Node * MCTS::select(Node* root)
 
 float MCTS::expand(Node * node)
 {
-    // expand the node by adding a child for each possible move
-    std::shared_ptr<Environment> const & env = node->getEnvironment();
+    std::optional<float> exactValue = getExactValue(node);
+    if (exactValue.has_value())
+    {
+        return exactValue.value();
+    }
 
-    torch::Tensor                           input  = m_NN->boardToInput(env);
-    std::pair<torch::Tensor, torch::Tensor> output = m_NN->predict(input);
+    // left over from a batched search with speculative evaluation
+    if (node->hasEvaluation())
+    {
+        auto [policy, value] = node->takeEvaluation();
+        return addChildren(node, policy.view({7}), value);
+    }
 
-    // policy output
-    torch::Tensor policy = output.first.view({7});
-    // value output (= step 3: evaluation)
-    float value = output.second.item<float>();
+    // policy output, value output (= step 3: evaluation)
+    auto [policy, value] = evaluateLeaf(node);
+    return addChildren(node, policy, value);
+}
 
-    std::vector<int> valid_moves = env->getValidMoves();
-    if (valid_moves.size() == 0)
+std::pair<torch::Tensor, float> MCTS::evaluateLeaf(Node * leaf)
+{
+    if (useSmallNetwork(leaf))
     {
-        return env->getWinner() == ePlayer::NONE ? 0 : 1;
+        m_SmallEvaluations++;
+        return m_SmallNN->evaluate(leaf->getEnvironment());
+    }
+    m_FullEvaluations++;
+    if (m_InferenceServer == nullptr)
+    {
+        return m_NN->evaluate(leaf->getEnvironment());
     }
 
-    if (env->getWinner() != ePlayer::NONE)
+    std::shared_ptr<Environment> const &           env    = leaf->getEnvironment();
+    std::optional<std::pair<torch::Tensor, float>> stored = m_NN->lookupEvaluation(env);
+    if (stored.has_value())
     {
-        return 1;
+        return stored.value();
     }
+    // wait for the server to run this position together with those of other threads
+    Evaluation evaluation = m_InferenceServer->submit(m_ServerModel, m_NN->boardToInput(env)).get();
+    m_NN->storeEvaluation(env, evaluation.policy, evaluation.value);
+    return std::make_pair(evaluation.policy.view({7}), evaluation.value);
+}
 
-    // add a child node to the leaf node for every possible action (= step 2: expansion)
-    for (auto const & move: valid_moves)
+bool MCTS::useSmallNetwork(Node const * leaf) const
+{
+    if (m_SmallNN == nullptr || leaf->getParent() == nullptr)
+    {
+        return false;
+    }
+    int const maxVisits = m_Settings->getSmallModelVisits();
+    if (maxVisits > 0 && leaf->getParent()->getVisits() < maxVisits)
+    {
+        return true;
+    }
+    int const maxDepth = m_Settings->getSmallModelDepth();
+    if (maxDepth <= 0)
+    {
+        return false;
+    }
+    int depth = 0;
+    for (Node const * current = leaf; current->getParent() != nullptr && depth <= maxDepth; current = current->getParent())
     {
-        // copy the environment and make the new move
-        std::shared_ptr<Environment> new_env = std::make_shared<Environment>(env);
-        new_env->makeMove(move);
+        depth++;
+    }
+    return depth > maxDepth;
+}
+
+std::optional<float> MCTS::getExactValue(Node * node)
+{
+    // the result of a proven node is exact, no need to evaluate it again
+    if (node->isProven())
+    {
+        return node->getProvenValue();
+    }
 
-        node->addChild(std::make_unique<Node>(node, std::move(new_env), move, policy[move].item<float>()));
+    // check for the end of the game before running the network
+    std::shared_ptr<Environment> const & env = node->getEnvironment();
+    if (env->getWinner() != ePlayer::NONE || !env->hasValidMoves())
+    {
+        node->setTerminal(true);
+        // the player who made the last move has either won or drawn
+        node->setProof(env->getWinner() != ePlayer::NONE ? eProof::WIN : eProof::DRAW);
+        propagateProof(node);
+        // the proof is all later visits need
+        releaseEnvironment(node);
+        return node->getProvenValue();
     }
+    return std::nullopt;
+}
+
+void MCTS::releaseEnvironment(Node * node) const
+{
+    if (NodeStorage::getActive() != nullptr && node != m_Root.get())
+    {
+        node->releaseEnvironment();
+    }
+}
+
+float MCTS::addChildren(Node * node, torch::Tensor const & policy, float value)
+{
+    // expand the node by adding a child for each possible move
+    std::shared_ptr<Environment> const & env = node->getEnvironment();
+
+    // add a child node to the leaf node for every possible action (= step 2: expansion)
+    for (auto const & move: env->getValidMoves())
+    {
+        // most children are never visited: if possible, their environment is only created once the search reaches them
+        std::shared_ptr<Environment> new_env = nullptr;
+        if (!Node::replaysEnvironments())
+        {
+            // copy the environment and make the new move
+            new_env = std::make_shared<Environment>(env);
+            new_env->makeMove(move);
+        }
+        node->addChild(acquireNode(node, std::move(new_env), move, policy[move].item<float>()));
+    }
+    m_NodeCount += (int)node->getChildren().size();
+    releaseEnvironment(node);
 
     return value;
 }
 
+void MCTS::propagateProof(Node * node)
+{
+    // minimax the proof up the tree, for as long as the parent's result becomes known
+    Node * current = node->getParent();
+    while (current != nullptr && !current->isProven())
+    {
+        bool allProven = true;
+        bool anyWin    = false;
+        bool anyDraw   = false;
+        for (auto const & child: current->getChildren())
+        {
+            switch (child->getProof())
+            {
+            case eProof::WIN:
+                anyWin = true;
+                break;
+            case eProof::DRAW:
+                anyDraw = true;
+                break;
+            case eProof::UNKNOWN:
+                allProven = false;
+                break;
+            default:
+                break;
+            }
+        }
+
+        // a child's win is a loss for the player who moved into the parent
+        if (anyWin)
+        {
+            current->setProof(eProof::LOSS);
+        }
+        else if (allProven)
+        {
+            current->setProof(anyDraw ? eProof::DRAW : eProof::WIN);
+        }
+        else
+        {
+            break;
+        }
+        current = current->getParent();
+    }
+}
+
+Node * MCTS::getWinningChild() const
+{
+    for (auto const & child: m_Root->getChildren())
+    {
+        if (child->getProof() == eProof::WIN)
+        {
+            return child.get();
+        }
+    }
+    return nullptr;
+}
+
 void MCTS::backpropagate(Node * leaf, float result)
 {
-    ePlayer player = leaf->getEnvironment()->getCurrentPlayer();
-    // backpropagate the result to the root
-    Node * current = leaf;
+    // the player to move alternates with every ply, so the positions on the path aren't needed:
+    // the result counts for the leaf's player, against its parent's, and so on
+    bool   leafPlayer = true;
+    Node * current    = leaf;
     while (current != nullptr)
     {
         current->incrementVisit();
         float value = current->getValue();
-        if (current->getEnvironment()->getCurrentPlayer() == player)
+        if (leafPlayer)
         {
             value += result;
         }
@@ -184,56 +1074,180 @@ void MCTS::backpropagate(Node * leaf, float result)
             value -= result;
         }
         current->setValue(value);
-        current = current->getParent();
+        current    = current->getParent();
+        leafPlayer = !leafPlayer;
     }
 }
 
 int MCTS::getBestMoveDeterministic() const
 {
-    // get move where visits is highest
-    float                                      max_visits = 0;
-    int                                        max_index  = 0;
-    std::vector<std::unique_ptr<Node>> const & moves      = m_Root->getChildren();
+    // always play a proven win
+    if (Node * winningChild = getWinningChild())
+    {
+        return winningChild->getMove();
+    }
+
+    // get move where visits is highest, skipping moves that are proven to lose unless every move loses
+    int                    max_visits = -1;
+    int                    max_index  = 0;
+    Node::Children const & moves      = m_Root->getChildren();
+    bool allLosing = std::all_of(moves.begin(), moves.end(), [](std::unique_ptr<Node> const & node) { return node->getProof() == eProof::LOSS; });
     for (int i = 0; i < (int)moves.size(); i++)
     {
+        if (moves[i]->getProof() == eProof::LOSS && !allLosing)
+        {
+            continue;
+        }
         if (moves[i]->getVisits() > max_visits)
         {
-            max_visits = moves[i]->getValue();
+            max_visits = moves[i]->getVisits();
             max_index  = i;
         }
     }
-    return max_index;
+    return moves.at(max_index)->getMove();
 }
 
-int MCTS::getBestMoveStochastic() const
+int MCTS::getBestMoveStochastic()
 {
-    std::vector<std::unique_ptr<Node>> const & children = m_Root->getChildren();
-    std::vector<int>                           moves;
+    // always play a proven win
+    if (Node * winningChild = getWinningChild())
+    {
+        return winningChild->getMove();
+    }
+
+    // don't pick moves that are proven to lose, unless every move loses
+    Node::Children const & children = m_Root->getChildren();
+    bool allLosing = std::all_of(children.begin(), children.end(), [](std::unique_ptr<Node> const & node) { return node->getProof() == eProof::LOSS; });
+    std::vector<int>       moves;
     for (auto const & node: children)
     {
-        moves.push_back(node->getVisits());
+        moves.push_back(node->getProof() == eProof::LOSS && !allLosing ? 0 : node->getVisits());
+    }
+    if (std::accumulate(moves.begin(), moves.end(), 0) == 0)
+    {
+        // the remaining moves were never visited: pick uniformly between them
+        for (int i = 0; i < (int)children.size(); i++)
+        {
+            moves[i] = children[i]->getProof() == eProof::LOSS && !allLosing ? 0 : 1;
+        }
     }
     // create a discrete distribution to pick from
     std::discrete_distribution<int> distribution(moves.begin(), moves.end());
-    int                             index = distribution(g_Generator);
+    int                             index = distribution(m_Generator);
     return children.at(index)->getMove();
 }
 
 int MCTS::getTreeDepth(std::unique_ptr<Node> const & root)
 {
-    // recursive function of getting height of the tree
-    if (root->getChildren().empty())
+    return collectTreeStatistics(root.get()).maxDepth;
+}
+
+bool MCTS::countsNodes() const
+{
+    return m_Settings->getSearchNodes() > 0 || m_Settings->logTreeStatistics();
+}
+
+int MCTS::countNodes(Node const * root)
+{
+    if (root == nullptr)
     {
         return 0;
     }
-    int max_depth = 0;
-    for (int i = 0; i < (int)root->getChildren().size(); i++)
+    int                       count = 0;
+    std::vector<Node const *> stack = {root};
+    while (!stack.empty())
     {
-        int depth = MCTS::getTreeDepth(root->getChildren().at(i));
-        if (depth > max_depth)
+        Node const * current = stack.back();
+        stack.pop_back();
+        count++;
+        for (auto const & child: current->getChildren())
         {
-            max_depth = depth;
+            stack.push_back(child.get());
         }
     }
-    return max_depth + 1;
+    return count;
+}
+
+TreeStatistics MCTS::collectTreeStatistics(Node const * root)
+{
+    TreeStatistics stats;
+    if (root == nullptr)
+    {
+        return stats;
+    }
+
+    int                                       children = 0;
+    std::vector<std::pair<Node const *, int>> stack    = {{root, 0}};
+    while (!stack.empty())
+    {
+        auto [current, depth] = stack.back();
+        stack.pop_back();
+
+        stats.nodes++;
+        stats.bytesUsed += current->getMemoryUsage();
+        if (NodeStorage::getActive() != nullptr && NodeStorage::getActive()->owns(current))
+        {
+            stats.storedBytes += sizeof(Node);
+        }
+        if (NodeStorage::getActive() != nullptr && NodeStorage::getActive()->owns(current->getChildren().data()))
+        {
+            stats.storedBytes += current->getChildren().capacity() * sizeof(std::unique_ptr<Node>);
+        }
+        stats.maxDepth = std::max(stats.maxDepth, depth);
+        if ((int)stats.depthHistogram.size() <= depth)
+        {
+            stats.depthHistogram.resize(depth + 1, 0);
+        }
+        stats.depthHistogram[depth]++;
+
+        if (!current->getChildren().empty())
+        {
+            stats.expandedNodes++;
+            children += (int)current->getChildren().size();
+            for (auto const & child: current->getChildren())
+            {
+                stack.emplace_back(child.get(), depth + 1);
+            }
+        }
+    }
+    stats.branchingFactor = stats.expandedNodes > 0 ? (float)children / (float)stats.expandedNodes : 0.0f;
+    return stats;
+}
+
+TreeStatistics MCTS::getTreeStatistics() const
+{
+    TreeStatistics stats = collectTreeStatistics(m_Root.get());
+    stats.reusedFraction = m_ReusedFraction;
+    stats.freeNodes        = (int)m_FreeNodes.size();
+    stats.fullEvaluations  = m_FullEvaluations;
+    stats.smallEvaluations = m_SmallEvaluations;
+    return stats;
+}
+
+void MCTS::logTreeStatistics() const
+{
+    TreeStatistics    stats = getTreeStatistics();
+    std::stringstream histogram;
+    for (int depth = 0; depth < (int)stats.depthHistogram.size(); depth++)
+    {
+        histogram << " " << depth << ":" << stats.depthHistogram[depth];
+    }
+    LINFO << "Tree: " << stats.nodes << " nodes, " << stats.expandedNodes << " expanded, depth " << stats.maxDepth << ", branching factor "
+          << stats.branchingFactor << ", " << stats.bytesUsed / 1024 << " KiB, " << 100 * stats.reusedFraction << "% reused, " << stats.freeNodes << " free. Depths:" << histogram.str();
+    if (m_SmallNN != nullptr)
+    {
+        LINFO << "Evaluations: " << stats.fullEvaluations << " by the full network, " << stats.smallEvaluations << " by the small network";
+    }
+    if (m_InferenceServer != nullptr)
+    {
+        m_InferenceServer->logStatistics();
+    }
+    if (NodeStorage::getActive() != nullptr)
+    {
+        // the positions of the root and of nodes the search is about to expand stay on the heap
+        float stored = stats.bytesUsed > 0 ? 100.0f * (float)stats.storedBytes / (float)stats.bytesUsed : 0.0f;
+        LINFO << "Tree memory: " << stats.storedBytes / 1024 << " KiB of nodes and children lists in the node file, "
+              << (stats.bytesUsed - stats.storedBytes) / 1024 << " KiB of positions on the heap (" << stored << "% moved off the heap)";
+        NodeStorage::getActive()->logStatistics();
+    }
 }
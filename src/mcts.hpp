@@ -1,10 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
+#include "batchEvaluator.hpp"
 #include "common.hpp"
+#include "inferenceServer.hpp"
 #include "neuralNetwork.hpp"
 #include "tree/node.hpp"
+#include "tree/treeSnapshot.hpp"
 #include "utils/settings.hpp"
 #include "utils/tqdm.h"
+#include "utils/types.hpp"
 
 /**
  * @brief The MCTS class is responsible for running the MCTS simulations,
@@ -26,10 +39,177 @@ class MCTS
 
     /**
      * @brief Continuously run the 4 steps of the MCTS algorithm.
-     * The amount of simulations is taken from the given settings
+     * Stops after the given amount of simulations, or earlier when the time or node budget
+     * from the settings is used up, or when early stopping is enabled and the search is settled.
+     *
+     * @param simulations: the maximum amount of simulations. 0 means no limit,
+     * which is only allowed when a time or node budget is set.
      */
     void run_simulations(int simulations);
 
+    /**
+     * @brief Gumbel root search for small simulation budgets: sample the top-k root moves
+     * with the gumbel-top-k trick, then divide the simulations between them with
+     * sequential halving. Below the root, the normal PUCT selection is used.
+     * Doesn't add dirichlet noise: the gumbel noise takes care of exploration.
+     *
+     * @param simulations: the amount of simulations
+     */
+    void run_gumbel(int simulations);
+
+    /**
+     * @brief After run_gumbel(), get the move that survived sequential halving
+     *
+     * @return int: the move with the highest gumbel + logit + sigma(q) score
+     */
+    int getGumbelMove() const;
+
+    /**
+     * @brief After run_gumbel(), get the improved policy, softmax(logits + sigma(completed q)),
+     * to use as a policy target.
+     *
+     * @return std::vector<float>: a probability for every column
+     */
+    std::vector<float> getImprovedPolicy() const;
+
+    /**
+     * @brief Run the simulations as coroutines that wait for their leaf evaluation,
+     * so the network can evaluate many leaves in one batch. The batch size and timeout are taken from the settings.
+     *
+     * @param simulations: the amount of simulations
+     */
+    void run_batched(int simulations);
+
+    /**
+     * @brief Run the simulations of several trees from a single thread, sharing one evaluator,
+     * e.g. for many games against the same network.
+     * New simulations are started round-robin until the evaluator's batch is full.
+     *
+     * @param trees: the trees to search. Their network must be the evaluator's network.
+     * @param simulations: the amount of simulations per tree
+     * @param evaluator: the evaluator that batches the leaves of all trees
+     */
+    static void run_batched(std::vector<MCTS *> const & trees, int simulations, BatchEvaluator & evaluator);
+
+    /**
+     * @brief Root-parallel search: run the given amount of independent searches from the current root,
+     * each on its own thread with its own random engine and dirichlet noise.
+     * The statistics of their root children are merged into this tree afterwards.
+     * All searches share this tree's networks: the eager network evaluates their leaves concurrently,
+     * a scripted or int8 network one leaf at a time. With an inference server, the leaves are batched there.
+     *
+     * @param simulations: the maximum amount of simulations per search
+     * @param searches: the amount of searches, including the one on this tree
+     */
+    void run_root_parallel(int simulations, int searches);
+
+    /**
+     * @brief Add the visits, values and proofs of the other tree's root children
+     * to the root children of this tree.
+     *
+     * @param other: a tree searched from the same position
+     */
+    void mergeRootStatistics(MCTS const & other);
+
+    /**
+     * @brief Keep running simulations on the current root in a background thread,
+     * until stopPondering() is called. Used to search while the opponent thinks.
+     *
+     */
+    void startPondering();
+
+    /**
+     * @brief Stop pondering and wait for the background thread to finish.
+     * Does nothing if not pondering.
+     *
+     */
+    void stopPondering();
+
+    /**
+     * @brief Return true if a pondering thread was started and not stopped yet
+     *
+     * @return bool
+     */
+    bool isPondering() const;
+
+    /**
+     * @brief Save the current tree (structure, priors, visits, values and root position) to a binary file
+     *
+     * @param path: the file to write to
+     * @return true if successful
+     */
+    bool saveTree(std::filesystem::path const & path);
+
+    /**
+     * @brief Replace the current tree with one saved by saveTree()
+     *
+     * @param path: the file to read
+     * @return true if successful
+     */
+    bool loadTree(std::filesystem::path const & path);
+
+    /**
+     * @brief Show or hide the progress bar while running simulations
+     *
+     * @param showProgress
+     */
+    void setShowProgress(bool showProgress);
+
+    /**
+     * @brief Enable or disable the dirichlet noise of the next searches, e.g. disabled for the
+     * fast searches of playout cap randomization, which play at full strength
+     *
+     * @param exploration: true to add noise if the settings enable it
+     */
+    void setExploration(bool exploration);
+
+    /**
+     * @brief Set a smaller, faster network for the leaves that matter less:
+     * deep in the tree, or below a parent with few visits (see the settings).
+     *
+     * @param smallNN: the small network, nullptr to always use the full network
+     */
+    void setSmallNetwork(std::shared_ptr<NeuralNetwork> smallNN);
+
+    /**
+     * @brief Send the evaluations of the full network to an inference server instead of running them directly,
+     * so the searches of many threads are batched together
+     *
+     * @param server: the server, nullptr to run the network directly
+     * @param model: the id of this tree's network on the server
+     */
+    void setInferenceServer(std::shared_ptr<InferenceServer> server, int model);
+
+    /**
+     * @brief Check if the most visited child of the root can still be overtaken.
+     *
+     * @param remainingSimulations: the upper bound of simulations that can still be run
+     * @return true if no other child can catch up with the most visited one
+     */
+    bool isSearchSettled(int remainingSimulations) const;
+
+    /**
+     * @brief Get the visits of the root's moves
+     *
+     * @return std::vector<int>: the visits per column
+     */
+    std::vector<int> getRootVisits() const;
+
+    /**
+     * @brief Get the distribution of the visits over the root's moves
+     *
+     * @param baseline: visits per column to leave out, e.g. the ones the root had before the current search
+     * @return std::vector<float>: the fraction of visits per column
+     */
+    std::vector<float> getRootVisitDistribution(std::vector<int> const & baseline = {}) const;
+
+    /**
+     * @brief Get the amount of simulations the last call to run_simulations() actually ran
+     *
+     * @return int
+     */
+    int getSimulationsUsed() const;
+
     /**
      * @brief The first step of the MCTS algorithm: keep selecting actions until a
      * position (Node) has been reached that has not yet been visited (expanded)
@@ -48,6 +228,33 @@ class MCTS
      */
     float expand(Node * node);
 
+    /**
+     * @brief Get the exact value of a node whose result is known, without running the network.
+     * Detects the end of the game, and marks and proves the node if so.
+     *
+     * @param node: the leaf node found by the select() method
+     * @return std::optional<float>: the exact value, or std::nullopt if the network is needed
+     */
+    std::optional<float> getExactValue(Node * node);
+
+    /**
+     * @brief Drop the environment of a node the search doesn't need it for anymore (an expanded or terminal node),
+     * if the tree is kept in a node storage: the node storage can't hold environments, so only the root keeps one
+     *
+     * @param node: the node
+     */
+    void releaseEnvironment(Node * node) const;
+
+    /**
+     * @brief Add a child for every valid move, with priors from the given policy
+     *
+     * @param node: the node to expand
+     * @param policy: the policy output of the network for this node
+     * @param value: the value output of the network for this node
+     * @return float: the value to backpropagate
+     */
+    float addChildren(Node * node, torch::Tensor const & policy, float value);
+
     /**
      * @brief The 4th and final step of the MCTS algorithm: Backpropagate the value
      * through the tree, up to the root node.
@@ -57,6 +264,15 @@ class MCTS
      */
     void backpropagate(Node * leaf, float result);
 
+    /**
+     * @brief Propagate the proven result of the given node up the tree, minimax-style:
+     * a parent loses if any child is a win for the opponent,
+     * and wins (or draws) once all children are proven to lose (or draw).
+     *
+     * @param node: the node whose result just became known
+     */
+    void propagateProof(Node * node);
+
     /**
      * @brief Get the root node of the tree
      *
@@ -71,6 +287,12 @@ class MCTS
     void setRoot(Node * root);
     void setRoot(std::unique_ptr<Node> root);
 
+    /**
+     * @brief Mix dirichlet noise into the priors of the root's children, expanding the root if needed.
+     * Should be called once per search.
+     *
+     * @param root: the root node
+     */
     void addDirichletNoise(Node* root);
 
     /**
@@ -85,19 +307,190 @@ class MCTS
      *
      * @return int: The move that was selected with stochastic picking.
      */
-    int getBestMoveStochastic() const;
+    int getBestMoveStochastic();
 
     /**
-     * @brief Get the depth of the tree, recursively.
+     * @brief Get the depth of the tree.
      *
      * @param root: the node to start counting from.
      * @return int: the depth of the tree from the given node to the end
      */
     static int getTreeDepth(std::unique_ptr<Node> const & root);
 
+    /**
+     * @brief Count the nodes in the tree, iteratively.
+     *
+     * @param root: the node to start counting from.
+     * @return int: the amount of nodes, including the given root
+     */
+    static int countNodes(Node const * root);
+
+    /**
+     * @brief Walk the current tree once and collect its statistics.
+     *
+     * @return TreeStatistics
+     */
+    TreeStatistics getTreeStatistics() const;
+
+    /**
+     * @brief Log the statistics of the current tree on a single line.
+     *
+     */
+    void logTreeStatistics() const;
+
   private:
+    /**
+     * @brief Collect the statistics of the tree under the given node, iteratively.
+     * The reused fraction is not known here and is left at 0.
+     *
+     * @param root: the node to start from
+     * @return TreeStatistics
+     */
+    static TreeStatistics collectTreeStatistics(Node const * root);
+
+    /**
+     * @brief Get a child of the root that is proven to win
+     *
+     * @return Node*: nullptr if there is none
+     */
+    Node * getWinningChild() const;
+
+    /**
+     * @brief The loop of the pondering thread: run simulations until told to stop,
+     * the root is solved or the node budget is reached.
+     *
+     */
+    void ponder();
+
+    /**
+     * @brief A single simulation as a coroutine: wait for the evaluation of the selected leaf, expand and backpropagate.
+     * A virtual loss is kept on the path while waiting, so other simulations in flight choose different leaves.
+     *
+     * @param leaf: the selected leaf, which must not be waiting for the network already
+     * @param evaluator: the evaluator to wait on
+     * @return SimulationTask
+     */
+    SimulationTask simulate(Node * leaf, BatchEvaluator & evaluator);
+
+    /**
+     * @brief Queue the children with the highest priors of a newly expanded node for speculative evaluation,
+     * if enabled in the settings
+     *
+     * @param node: the expanded node
+     * @param evaluator: the evaluator to queue the children on
+     */
+    void speculateChildren(Node * node, BatchEvaluator & evaluator);
+
+    /**
+     * @brief Evaluate a leaf's position with the right network: the small network, the inference server or the full network
+     *
+     * @param leaf: the leaf to evaluate
+     * @return std::pair<torch::Tensor, float>: the policy output (one value per column) and the value output
+     */
+    std::pair<torch::Tensor, float> evaluateLeaf(Node * leaf);
+
+    /**
+     * @brief Choose the network to evaluate a leaf with
+     *
+     * @param leaf: the leaf to evaluate
+     * @return true if the small network should be used
+     */
+    bool useSmallNetwork(Node const * leaf) const;
+
+    /**
+     * @brief Add (or remove) a virtual loss on every node from the given leaf up to the root's children
+     *
+     * @param leaf: the selected leaf
+     * @param amount: 1 to add a virtual loss, -1 to remove it
+     */
+    static void applyVirtualLoss(Node * leaf, int amount);
+
+    /**
+     * @brief Make sure the next expansion fits in the node budget from the settings.
+     * If pruning is enabled, the tree is pruned when the budget is nearly used.
+     *
+     * @return true if the search can continue
+     */
+    bool enforceNodeBudget();
+
+    /**
+     * @brief Collapse the least visited subtrees back into leaves until
+     * the tree has at most the given amount of nodes. Their nodes are recycled.
+     *
+     * @param targetNodes: the amount of nodes to prune to
+     */
+    void pruneTree(int targetNodes);
+
+    /**
+     * @brief Check whether the amount of nodes in the tree is kept track of:
+     * with a node budget, or when logging tree statistics
+     *
+     * @return bool
+     */
+    bool countsNodes() const;
+
+    /**
+     * @brief Move every node below the given node to the free list.
+     *
+     * @param node: the node to turn back into a leaf
+     * @return int: the amount of recycled nodes
+     */
+    int recycleChildren(Node * node);
+
+    /**
+     * @brief Get a node from the free list, or allocate a new one if the list is empty.
+     *
+     * @return std::unique_ptr<Node>
+     */
+    std::unique_ptr<Node> acquireNode(Node * parent, std::shared_ptr<Environment> env, int move, float prior);
+
+    /**
+     * @brief Get the completed q-values of the root's children, normalized to [0, 1].
+     * Unvisited children get the mixed value of the root's value estimate and the visited children.
+     *
+     * @return std::vector<float>: a value per root child
+     */
+    std::vector<float> getCompletedQ() const;
+
+    /**
+     * @brief The sigma(q) transformation of the gumbel root search
+     *
+     * @param q: a value in [0, 1]
+     * @return float
+     */
+    float sigma(float q) const;
+
+
     std::shared_ptr<Settings> m_Settings = nullptr;
     std::unique_ptr<Node>             m_Root     = nullptr;
     std::shared_ptr<NeuralNetwork>    m_NN       = nullptr;
     torch::Device                     m_Device   = torch::kCPU;
+    // every tree has its own random engine, so searches can run in parallel
+    std::default_random_engine m_Generator;
+    bool                       m_ShowProgress = true;
+    bool                       m_Exploration  = true;
+    std::shared_ptr<NeuralNetwork> m_SmallNN   = nullptr;
+    std::shared_ptr<InferenceServer> m_InferenceServer = nullptr;
+    int                              m_ServerModel     = -1;
+    // evaluations per network tier since the last setRoot()
+    int m_FullEvaluations  = 0;
+    int m_SmallEvaluations = 0;
+    int                        m_SimulationsUsed = 0;
+
+    // gumbel noise + logit per root child, and the root children still in the running, set by run_gumbel()
+    std::vector<float> m_GumbelLogits;
+    std::vector<int>   m_GumbelCandidates;
+
+    // nodes from pruned subtrees, reused by expand()
+    std::vector<std::unique_ptr<Node>> m_FreeNodes;
+    // nodes in the tree, counted once per setRoot() and updated by expansions and pruning. Only exact if countsNodes().
+    int m_NodeCount = 0;
+    // leaves of batched simulations that are waiting for the network
+    std::unordered_set<Node *> m_PendingLeaves;
+
+    std::thread       m_PonderThread;
+    std::atomic<bool> m_StopPondering = false;
+
+    // fraction of the previous tree's nodes that were kept by the last setRoot(), only measured when logging tree statistics
+    float m_ReusedFraction = 0.0f;
 };
\ No newline at end of file
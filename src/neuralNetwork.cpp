@@ -1,20 +1,113 @@
 #include "neuralNetwork.hpp"
 
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+// FNV-1a, to identify the loaded weights
+constexpr uint64_t FNV_OFFSET = UINT64_C(14695981039346656037);
+constexpr uint64_t FNV_PRIME  = UINT64_C(1099511628211);
+
+// the fixed architecture of models saved before it was stored with the weights
+constexpr int64_t LEGACY_BLOCKS         = 19;
+constexpr int64_t LEGACY_POLICY_FILTERS = 2;
+constexpr int64_t LEGACY_VALUE_FILTERS  = 1;
+
+uint64_t addToChecksum(uint64_t checksum, uint8_t const * bytes, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        checksum ^= bytes[i];
+        checksum *= FNV_PRIME;
+    }
+    return checksum;
+}
+
+// TorchScript attribute names can't contain dots
+std::string attributeName(std::string name)
+{
+    std::replace(name.begin(), name.end(), '.', '_');
+    return name;
+}
+
+// a convolution followed by a batch norm, which freezing folds into a single convolution
+std::string convBatchNorm(std::string const & conv, std::string const & batchNorm, std::string const & input, int padding)
+{
+    std::string const pad = std::to_string(padding);
+    return "torch.batch_norm(torch.conv2d(" + input + ", self." + conv + "_weight, self." + conv + "_bias, [1, 1], [" + pad + ", " + pad +
+           "]), self." + batchNorm + "_weight, self." + batchNorm + "_bias, self." + batchNorm + "_running_mean, self." + batchNorm +
+           "_running_var, False, 0.1, 1e-05, True)";
+}
+
+// a linear layer, read from the registered weight and bias
+std::string linear(std::string const & layer, std::string const & input)
+{
+    return "torch.linear(" + input + ", self." + layer + "_weight, self." + layer + "_bias)";
+}
+
+/**
+ * @brief Write the forward pass of the network as TorchScript, mirroring NetworkImpl::forward
+ *
+ * @param net: the network
+ * @return std::string: the TorchScript source of the forward method
+ */
+std::string scriptSource(Network const & net)
+{
+    std::string source = "def forward(self, x):\n";
+    source += "    x = torch.relu(" + convBatchNorm("convInput_conv1", "convInput_batchNorm1", "x", 1) + ")\n";
+    for (size_t i = 0; i < net->resBlocks->size(); i++)
+    {
+        std::string const block = "resBlocks_" + std::to_string(i);
+        source += "    y = torch.relu(" + convBatchNorm(block + "_conv1", block + "_batchNorm1", "x", 1) + ")\n";
+        source += "    x = torch.relu(" + convBatchNorm(block + "_conv2", block + "_batchNorm2", "y", 1) + " + x)\n";
+    }
+    source += "    value = torch.relu(" + convBatchNorm("valueHead_convValue", "valueHead_batchNormValue", "x", 0) + ")\n";
+    source += "    value = torch.relu(" + linear("valueHead_linearValue1", "torch.flatten(value, 1)") + ")\n";
+    source += "    value = torch.tanh(" + linear("valueHead_linearValue2", "value") + ")\n";
+    source += "    policy = torch.relu(" + convBatchNorm("policyHead_convPolicy", "policyHead_batchNormPolicy", "x", 0) + ")\n";
+    source += "    policy = torch.softmax(" + linear("policyHead_linearPolicy", "torch.flatten(policy, 1)") + ", 1)\n";
+    source += "    return policy, value\n";
+    return source;
+}
+} // namespace
+
 NeuralNetwork::NeuralNetwork(std::shared_ptr<Settings> settings)
+  : NeuralNetwork(settings, settings->getModelPath(), settings->getFilters())
+{
+    if (!m_Settings->getEvaluationStorePath().empty())
+    {
+        m_Store = std::make_shared<EvaluationStore>(m_Settings->getEvaluationStorePath(), m_Settings->getEvaluationStoreSize());
+    }
+    // the scripted model replaces the main network, other networks like the small one keep their own weights
+    if (!m_Settings->getScriptedModelPath().empty() && !loadScriptedModel(m_Settings->getScriptedModelPath()))
+    {
+        LWARN << "Falling back to the eager network";
+    }
+}
+
+NeuralNetwork::NeuralNetwork(std::shared_ptr<Settings> settings, std::filesystem::path const & modelPath, int filters)
   : m_Settings(settings)
-  , m_Net(Network(m_Settings->getInputPlanes(), m_Settings->getRows(), m_Settings->getCols(), m_Settings->getOutputSize(), 256, 2, 1))
+  , m_Net(createNetwork({m_Settings->getResidualBlocks(), filters, m_Settings->getPolicyFilters(), m_Settings->getValueFilters(),
+                         (int64_t)m_Settings->getBlockType()}))
 {
     if (m_Settings->useCUDA())
     {
         m_Device = torch::Device(torch::kCUDA);
     }
-    loadModel(settings->getModelPath());
-    m_Net->eval();
-    m_Net->to(m_Device);
+    if (!loadModel(modelPath))
+    {
+        // keep the new network usable for inference anyway
+        setNetwork(m_Net);
+    }
 }
 
 NeuralNetwork::~NeuralNetwork()
 {
+    if (m_Store != nullptr)
+    {
+        m_Store->logStatistics();
+    }
     LDEBUG << "Destroying NeuralNetwork";
 }
 
@@ -23,6 +116,44 @@ Network NeuralNetwork::getNetwork()
     return m_Net;
 }
 
+Network NeuralNetwork::createNetwork(std::vector<int64_t> const & architecture) const
+{
+    if (architecture.size() != 5)
+    {
+        LFATAL << "Invalid network architecture: " << architecture;
+    }
+    return Network(m_Settings->getInputPlanes(), m_Settings->getRows(), m_Settings->getCols(), m_Settings->getOutputSize(), architecture[0], architecture[1],
+                   architecture[2], architecture[3], (eBlockType)architecture[4]);
+}
+
+void NeuralNetwork::setNetwork(Network net)
+{
+    m_Net = net;
+    m_Net->eval();
+    m_Net->to(m_Device);
+    // the batch norms are folded for inference, training mode drops the folded weights again
+    m_Net->fuse();
+
+    // the other backends were built from the previous weights
+    m_Scripted  = nullptr;
+    m_Quantized = nullptr;
+
+    // FNV-1a over all weights: stored evaluations of other weights are invalid
+    m_Checksum             = FNV_OFFSET;
+    auto addTensorChecksum = [this](torch::Tensor const & tensor) {
+        torch::Tensor cpuTensor = tensor.detach().to(torch::kCPU).contiguous();
+        m_Checksum              = addToChecksum(m_Checksum, static_cast<uint8_t const *>(cpuTensor.data_ptr()), cpuTensor.nbytes());
+    };
+    for (auto const & parameter: m_Net->parameters())
+    {
+        addTensorChecksum(parameter);
+    }
+    for (auto const & buffer: m_Net->buffers())
+    {
+        addTensorChecksum(buffer);
+    }
+}
+
 torch::Tensor NeuralNetwork::boardToInput(torch::Tensor const & board, ePlayer player, int inputPlanes)
 {
     // Create input tensor
@@ -71,9 +202,65 @@ torch::Tensor NeuralNetwork::boardToInput(std::shared_ptr<Environment> const & e
 
 std::pair<torch::Tensor, torch::Tensor> NeuralNetwork::predict(torch::Tensor & input)
 {
+    // the eager network only reads its weights in evaluation mode, so threads can run it at the same time.
+    // The scripted and int8 backends aren't known to be safe for that: one thread at a time.
+    if (m_Scripted != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_BackendMutex);
+        auto                        output = m_Scripted->forward({input}).toTuple()->elements();
+        return std::make_pair(output[0].toTensor(), output[1].toTensor());
+    }
+    if (m_Quantized != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_BackendMutex);
+        return m_Quantized->forward(input);
+    }
     return m_Net->forward(input);
 }
 
+std::pair<torch::Tensor, float> NeuralNetwork::evaluate(std::shared_ptr<Environment> const & env)
+{
+    std::optional<std::pair<torch::Tensor, float>> stored = lookupEvaluation(env);
+    if (stored.has_value())
+    {
+        return stored.value();
+    }
+
+    torch::Tensor                           input  = boardToInput(env);
+    std::pair<torch::Tensor, torch::Tensor> output = predict(input);
+    torch::Tensor                           policy = output.first.view({7});
+    float                                   value  = output.second.item<float>();
+    storeEvaluation(env, policy, value);
+    return std::make_pair(policy, value);
+}
+
+std::optional<std::pair<torch::Tensor, float>> NeuralNetwork::lookupEvaluation(std::shared_ptr<Environment> const & env)
+{
+    if (m_Store == nullptr)
+    {
+        return std::nullopt;
+    }
+    std::optional<std::pair<torch::Tensor, float>> stored = m_Store->lookup(m_Checksum, EvaluationStore::positionKey(env));
+    if (stored.has_value())
+    {
+        stored->first = stored->first.to(m_Device);
+    }
+    return stored;
+}
+
+void NeuralNetwork::storeEvaluation(std::shared_ptr<Environment> const & env, torch::Tensor const & policy, float value)
+{
+    if (m_Store != nullptr)
+    {
+        m_Store->insert(m_Checksum, EvaluationStore::positionKey(env), policy, value);
+    }
+}
+
+uint64_t NeuralNetwork::getChecksum() const
+{
+    return m_Checksum;
+}
+
 bool NeuralNetwork::loadModel(std::filesystem::path path)
 {
     try
@@ -81,11 +268,43 @@ bool NeuralNetwork::loadModel(std::filesystem::path path)
         if (!std::filesystem::exists(path)){
             LWARN << "Model not found, creating a new one with the given name";
             std::filesystem::create_directories(std::filesystem::path(path).parent_path());
-            torch::save(this->m_Net, path);
+            writeModel(path);
         }
         // load model from path
         LINFO << "Loading model from: " << path;
-        torch::load(this->m_Net, path);
+        torch::serialize::InputArchive archive;
+        archive.load_from(path.string());
+
+        // the model's own architecture, regardless of the settings
+        Network       net = nullptr;
+        torch::Tensor architecture;
+        if (archive.try_read("architecture", architecture))
+        {
+            architecture = architecture.to(torch::kCPU).to(torch::kLong).contiguous();
+            std::vector<int64_t> sizes(architecture.data_ptr<int64_t>(), architecture.data_ptr<int64_t>() + architecture.numel());
+            if (sizes.size() == 4)
+            {
+                // saved before there were other kinds of blocks
+                sizes.push_back((int64_t)eBlockType::RESIDUAL);
+            }
+            net = createNetwork(sizes);
+            net->load(archive);
+        }
+        else
+        {
+            // saved before the architecture was stored: 19 residual blocks, 2 policy & 1 value filters,
+            // and the width of the saved input convolution (256 for the main model)
+            torch::serialize::InputArchive convInput, conv1;
+            torch::Tensor                  inputWeight;
+            archive.read("convInput", convInput);
+            convInput.read("conv1", conv1);
+            conv1.read("weight", inputWeight);
+            net = createNetwork({LEGACY_BLOCKS, inputWeight.size(0), LEGACY_POLICY_FILTERS, LEGACY_VALUE_FILTERS, (int64_t)eBlockType::RESIDUAL});
+            net->loadLegacy(archive);
+        }
+        setNetwork(net);
+        LINFO << "Network: " << m_Net->getArchitecture()[0] << " " << blockTypeToString(m_Net->getBlockType()) << " blocks of " << m_Net->getArchitecture()[1]
+              << " filters";
     }
     catch (std::exception const & e)
     {
@@ -113,7 +332,7 @@ std::filesystem::path NeuralNetwork::saveModel(std::filesystem::path path)
             std::filesystem::remove(path);
         }
         // save model to path
-        torch::save(this->m_Net, path);
+        writeModel(path);
         LINFO << "Saved model to: " << path;
     }
     catch (std::exception const & e)
@@ -121,4 +340,117 @@ std::filesystem::path NeuralNetwork::saveModel(std::filesystem::path path)
         LFATAL << "Error saving model: " << e.what();
     }
     return path;
-}
\ No newline at end of file
+}
+
+void NeuralNetwork::writeModel(std::filesystem::path const & path)
+{
+    // the architecture is saved with the weights, so loading doesn't depend on the settings
+    torch::serialize::OutputArchive archive;
+    m_Net->save(archive);
+    archive.write("architecture", torch::tensor(m_Net->getArchitecture()));
+    archive.save_to(path.string());
+}
+
+std::filesystem::path NeuralNetwork::exportScriptedModel(std::filesystem::path path)
+{
+    try
+    {
+        if (path.extension() != ".pt")
+        {
+            path.replace_extension(".pt");
+        }
+        if (!path.parent_path().empty())
+        {
+            std::filesystem::create_directories(path.parent_path());
+        }
+
+        if (m_Net->getBlockType() != eBlockType::RESIDUAL)
+        {
+            throw std::runtime_error("only networks of residual blocks can be exported, not " + blockTypeToString(m_Net->getBlockType()));
+        }
+        // the weights become attributes of a scripted module with the same forward pass
+        torch::jit::Module script("Network");
+        for (auto const & parameter: m_Net->named_parameters())
+        {
+            script.register_parameter(attributeName(parameter.key()), parameter.value().detach(), false);
+        }
+        for (auto const & buffer: m_Net->named_buffers())
+        {
+            script.register_buffer(attributeName(buffer.key()), buffer.value().detach());
+        }
+        script.define(scriptSource(m_Net));
+        script.eval();
+
+        // freezing inlines the weights as constants and folds the batch norms into the convolutions
+        torch::jit::Module frozen = torch::jit::freeze(script);
+        frozen.save(path.string());
+        LINFO << "Exported scripted model to: " << path;
+    }
+    catch (std::exception const & e)
+    {
+        LFATAL << "Error exporting scripted model: " << e.what();
+    }
+    return path;
+}
+
+bool NeuralNetwork::loadScriptedModel(std::filesystem::path const & path)
+{
+    try
+    {
+        LINFO << "Loading scripted model from: " << path;
+        torch::jit::Module module = torch::jit::load(path.string(), m_Device);
+        module.eval();
+        // fuses conv, add & relu for the device the model runs on, so it's not part of the exported file
+        m_Scripted = std::make_shared<torch::jit::Module>(torch::jit::optimize_for_inference(module));
+
+        // the folded weights are constants of the graph, so identify them by the file
+        std::ifstream        file(path, std::ios::binary);
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        m_Checksum = addToChecksum(FNV_OFFSET, bytes.data(), bytes.size());
+    }
+    catch (std::exception const & e)
+    {
+        LWARN << "Error loading scripted model: " << e.what();
+        m_Scripted = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool NeuralNetwork::isScripted() const
+{
+    return m_Scripted != nullptr;
+}
+
+bool NeuralNetwork::quantize(torch::Tensor const & calibration)
+{
+    if (m_Device.is_cuda())
+    {
+        LWARN << "Int8 inference only runs on the CPU, keeping the fp32 network";
+        return false;
+    }
+    if (m_Scripted != nullptr)
+    {
+        // inference would keep running on the scripted model
+        LWARN << "Int8 inference can't be combined with a scripted model, keeping the scripted model";
+        return false;
+    }
+    try
+    {
+        m_Quantized = std::make_shared<QuantizedNetwork>(m_Net, calibration);
+        // int8 evaluations differ from the fp32 ones stored for the same weights
+        m_Checksum = addToChecksum(m_Checksum, reinterpret_cast<uint8_t const *>("int8"), 4);
+    }
+    catch (std::exception const & e)
+    {
+        LWARN << "Error quantizing model: " << e.what();
+        m_Quantized = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool NeuralNetwork::isQuantized() const
+{
+    return m_Quantized != nullptr;
+}
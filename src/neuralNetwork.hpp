@@ -1,14 +1,27 @@
 #pragma once
 
 #include <filesystem>
+#include <mutex>
 #include <string>
 
 #include "common.hpp"
 #include "connect4/environment.hpp"
+#include "evaluationStore.hpp"
 #include "neuralNetwork/network.hpp"
+#include "neuralNetwork/quantizedNetwork.hpp"
 #include "utils/settings.hpp"
 #include "utils/utils.hpp"
 
+/**
+ * @brief The network's output for a single position
+ *
+ */
+struct Evaluation
+{
+    torch::Tensor policy;
+    float         value = 0.0f;
+};
+
 /**
  * @brief The NeuralNetwork class holds the torch Network to run inference with.
  * It also features some methods to load & save the model, and
@@ -19,6 +32,16 @@ class NeuralNetwork
 {
   public:
     NeuralNetwork(std::shared_ptr<Settings> settings);
+
+    /**
+     * @brief Construct a network of the given width, without the persistent evaluation store or the scripted model,
+     * e.g. the small network of a two-tier search
+     *
+     * @param settings
+     * @param modelPath: path to the saved weights, created if it doesn't exist yet
+     * @param filters: the amount of convolutional filters each layer of a new model, saved models keep their own
+     */
+    NeuralNetwork(std::shared_ptr<Settings> settings, std::filesystem::path const & modelPath, int filters);
     ~NeuralNetwork();
 
     /**
@@ -40,7 +63,8 @@ class NeuralNetwork
     torch::Tensor boardToInput(std::shared_ptr<Environment> const & env);
 
     /**
-     * @brief Run inference on the network
+     * @brief Run inference on the network. Can be called from several threads:
+     * the eager network runs concurrently, the scripted and int8 backends one call at a time.
      *
      * @param input: the input to give the network
      * @return std::pair<torch::Tensor, torch::Tensor>: two outputs: policy & value output
@@ -48,7 +72,40 @@ class NeuralNetwork
     std::pair<torch::Tensor, torch::Tensor> predict(torch::Tensor & input);
 
     /**
-     * @brief Load the weights into the network.
+     * @brief Evaluate a single position, using the persistent evaluation store if there is one
+     *
+     * @param env: the position to evaluate
+     * @return std::pair<torch::Tensor, float>: the policy output (one value per column) and the value output
+     */
+    std::pair<torch::Tensor, float> evaluate(std::shared_ptr<Environment> const & env);
+
+    /**
+     * @brief Find the evaluation of a position in the persistent evaluation store
+     *
+     * @param env: the position
+     * @return std::optional<std::pair<torch::Tensor, float>>: the policy and value output, if stored
+     */
+    std::optional<std::pair<torch::Tensor, float>> lookupEvaluation(std::shared_ptr<Environment> const & env);
+
+    /**
+     * @brief Add the evaluation of a position to the persistent evaluation store, if there is one
+     *
+     * @param env: the position
+     * @param policy: the policy output
+     * @param value: the value output
+     */
+    void storeEvaluation(std::shared_ptr<Environment> const & env, torch::Tensor const & policy, float value);
+
+    /**
+     * @brief Get the checksum of the loaded weights, which identifies the model
+     *
+     * @return uint64_t
+     */
+    uint64_t getChecksum() const;
+
+    /**
+     * @brief Load the weights into the network, and prepare it for inference.
+     * A scripted or int8 backend of the previous weights is dropped.
      *
      * @param modelPath: path to the saved weights
      * @return true if successful
@@ -63,6 +120,45 @@ class NeuralNetwork
      */
     std::filesystem::path saveModel(std::filesystem::path modelPath);
 
+    /**
+     * @brief Export the network to a frozen TorchScript file, with the batch norms folded into the convolutions.
+     * The result can be loaded as an alternative backend with loadScriptedModel.
+     *
+     * @param path: the path to save the scripted model to
+     * @return std::filesystem::path: the resulting path
+     */
+    std::filesystem::path exportScriptedModel(std::filesystem::path path);
+
+    /**
+     * @brief Load a frozen TorchScript model, which is then used instead of the eager network for inference
+     *
+     * @param path: path to the scripted model
+     * @return true if successful
+     */
+    bool loadScriptedModel(std::filesystem::path const & path);
+
+    /**
+     * @brief Check whether inference runs on a scripted model instead of the eager network
+     *
+     * @return true if a scripted model is loaded
+     */
+    bool isScripted() const;
+
+    /**
+     * @brief Switch inference to an int8 copy of the residual trunk. CPU only, and not with a scripted model.
+     *
+     * @param calibration: a batch of input positions, to measure the range of every activation
+     * @return true if successful
+     */
+    bool quantize(torch::Tensor const & calibration);
+
+    /**
+     * @brief Check whether inference runs on the int8 trunk
+     *
+     * @return true if the network is quantized
+     */
+    bool isQuantized() const;
+
     /**
      * @brief Get the Network
      *
@@ -71,7 +167,38 @@ class NeuralNetwork
     Network getNetwork();
 
   private:
+    /**
+     * @brief Create a network of the given architecture for the configured board
+     *
+     * @param architecture: the amount of residual blocks, filters, policy filters and value filters
+     * @return Network
+     */
+    Network createNetwork(std::vector<int64_t> const & architecture) const;
+
+    /**
+     * @brief Use the given network for inference: evaluation mode, on the device, with folded batch norms
+     *
+     * @param net: the network with its loaded weights
+     */
+    void setNetwork(Network net);
+
+    /**
+     * @brief Write the weights and the architecture to a file
+     *
+     * @param path
+     */
+    void writeModel(std::filesystem::path const & path);
+
     torch::Device             m_Device   = torch::Device(torch::kCPU);
     std::shared_ptr<Settings> m_Settings = nullptr;
     Network                   m_Net      = nullptr;
+    uint64_t                  m_Checksum = 0;
+    // frozen TorchScript backend, nullptr if the eager network is used
+    std::shared_ptr<torch::jit::Module> m_Scripted = nullptr;
+    // int8 trunk, nullptr if inference runs in fp32
+    std::shared_ptr<QuantizedNetwork> m_Quantized = nullptr;
+    // serializes the scripted and int8 backends between threads
+    std::mutex m_BackendMutex;
+    // evaluations that survive restarts, nullptr if disabled
+    std::shared_ptr<EvaluationStore> m_Store = nullptr;
 };
\ No newline at end of file
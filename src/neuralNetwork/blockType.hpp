@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Enum that represents the kind of block the network's trunk is made of
+ *
+ */
+enum class eBlockType
+{
+    RESIDUAL     = 0, // two full 3x3 convolutions
+    BOTTLENECK   = 1, // 1x1 reduce, 3x3, 1x1 expand
+    DEPTHWISE    = 2, // two depthwise-separable convolutions
+    DEPTHWISE_SE = 3  // two depthwise-separable convolutions with squeeze-and-excitation
+};
+
+/**
+ * @brief Get the block type of the given name, as used on the command line
+ *
+ * @param name: residual, bottleneck, depthwise or depthwise-se
+ * @return eBlockType
+ */
+inline eBlockType blockTypeFromString(std::string const& name)
+{
+    if (name == "residual")
+    {
+        return eBlockType::RESIDUAL;
+    }
+    if (name == "bottleneck")
+    {
+        return eBlockType::BOTTLENECK;
+    }
+    if (name == "depthwise")
+    {
+        return eBlockType::DEPTHWISE;
+    }
+    if (name == "depthwise-se")
+    {
+        return eBlockType::DEPTHWISE_SE;
+    }
+    throw std::invalid_argument("unknown block type " + name);
+}
+
+/**
+ * @brief Get the name of the given block type
+ *
+ * @param type
+ * @return std::string
+ */
+inline std::string blockTypeToString(eBlockType type)
+{
+    switch (type)
+    {
+        case eBlockType::RESIDUAL:
+            return "residual";
+        case eBlockType::BOTTLENECK:
+            return "bottleneck";
+        case eBlockType::DEPTHWISE:
+            return "depthwise";
+        case eBlockType::DEPTHWISE_SE:
+            return "depthwise-se";
+    }
+    return "unknown";
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../common.hpp"
+#include "fusedConv.hpp"
+#include "trunkBlock.hpp"
+
+/**
+ * @brief A residual block that reduces the filters with a 1x1 convolution, runs the 3x3 convolution
+ * on the reduced filters, and expands them again with a 1x1 convolution.
+ *
+ */
+struct BottleneckBlockImpl : public TrunkBlock
+{
+    /**
+     * @brief Construct a new bottleneck block
+     *
+     * @param filters: the amount of input and output filters
+     * @param reduced: the amount of filters of the 3x3 convolution
+     */
+    BottleneckBlockImpl(int filters, int reduced)
+    {
+        register_module("conv1", conv1 = torch::nn::Conv2d(torch::nn::Conv2dOptions(filters, reduced, 1).stride(1)));
+        register_module("batchNorm1", batchNorm1 = torch::nn::BatchNorm2d(reduced));
+
+        register_module("conv2", conv2 = torch::nn::Conv2d(torch::nn::Conv2dOptions(reduced, reduced, 3).padding(1).stride(1)));
+        register_module("batchNorm2", batchNorm2 = torch::nn::BatchNorm2d(reduced));
+
+        register_module("conv3", conv3 = torch::nn::Conv2d(torch::nn::Conv2dOptions(reduced, filters, 1).stride(1)));
+        register_module("batchNorm3", batchNorm3 = torch::nn::BatchNorm2d(filters));
+    }
+
+    /**
+     * @brief Method to make a forward pass through the neural network
+     *
+     * @param input: the input tensor
+     * @return torch::Tensor: the output tensor
+     */
+    torch::Tensor forward(torch::Tensor const& input) override
+    {
+        if (fused1.isFolded())
+        {
+            torch::Tensor x = fused1.forward(input).relu_();
+            x               = fused2.forward(x).relu_();
+            x               = fused3.forward(x);
+            return x.add_(input).relu_();
+        }
+        // reduce, 3x3, expand
+        torch::Tensor x = torch::relu(batchNorm1(conv1(input)));
+        x               = torch::relu(batchNorm2(conv2(x)));
+        x               = batchNorm3(conv3(x));
+        // skip connection, then relu
+        return torch::relu(x + input);
+    }
+
+    /**
+     * @brief Fold the batch normalisations into the convolutions, for inference
+     *
+     */
+    void fuse() override
+    {
+        fused1.fold(conv1, batchNorm1, 0);
+        fused2.fold(conv2, batchNorm2, 1);
+        fused3.fold(conv3, batchNorm3, 0);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fused1.clear();
+            fused2.clear();
+            fused3.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
+    torch::nn::Conv2d      conv1 = nullptr, conv2 = nullptr, conv3 = nullptr;
+    torch::nn::BatchNorm2d batchNorm1 = nullptr, batchNorm2 = nullptr, batchNorm3 = nullptr;
+    FusedConv              fused1, fused2, fused3;
+};
+TORCH_MODULE(BottleneckBlock);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../common.hpp"
+#include "fusedConv.hpp"
 
 /**
  * @brief A set of layers reprenting a convolutional block
@@ -29,11 +30,39 @@ struct ConvBlockImpl : public torch::nn::Module
      */
     torch::Tensor forward(torch::Tensor const& x)
     {
+        if (fused1.isFolded())
+        {
+            return fused1.forward(x).relu_();
+        }
         // convolutional layer, then batch normalisation, then ReLU
         return torch::relu(batchNorm1(conv1(x)));
     }
 
+    /**
+     * @brief Fold the batch normalisation into the convolution, for inference
+     *
+     */
+    void fuse()
+    {
+        fused1.fold(conv1, batchNorm1, 1);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fused1.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
     torch::nn::Conv2d      conv1      = nullptr;
     torch::nn::BatchNorm2d batchNorm1 = nullptr;
+    FusedConv              fused1;
 };
 TORCH_MODULE(ConvBlock);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../common.hpp"
+#include "fusedConv.hpp"
+#include "trunkBlock.hpp"
+
+/**
+ * @brief A residual block of two depthwise-separable convolutions: a 3x3 convolution per filter,
+ * followed by a 1x1 convolution across the filters. Optionally, squeeze-and-excitation scales
+ * each filter by a weight computed from the whole board.
+ *
+ */
+struct DepthwiseBlockImpl : public TrunkBlock
+{
+    /**
+     * @brief Construct a new depthwise-separable block
+     *
+     * @param filters: the amount of input and output filters
+     * @param squeezeExcitation: whether to add squeeze-and-excitation before the skip connection
+     */
+    DepthwiseBlockImpl(int filters, bool squeezeExcitation)
+      : m_Filters(filters)
+    {
+        register_module("depthwise1", depthwise1 = torch::nn::Conv2d(torch::nn::Conv2dOptions(filters, filters, 3).padding(1).stride(1).groups(filters)));
+        register_module("batchNormDepthwise1", batchNormDepthwise1 = torch::nn::BatchNorm2d(filters));
+        register_module("pointwise1", pointwise1 = torch::nn::Conv2d(torch::nn::Conv2dOptions(filters, filters, 1).stride(1)));
+        register_module("batchNormPointwise1", batchNormPointwise1 = torch::nn::BatchNorm2d(filters));
+
+        register_module("depthwise2", depthwise2 = torch::nn::Conv2d(torch::nn::Conv2dOptions(filters, filters, 3).padding(1).stride(1).groups(filters)));
+        register_module("batchNormDepthwise2", batchNormDepthwise2 = torch::nn::BatchNorm2d(filters));
+        register_module("pointwise2", pointwise2 = torch::nn::Conv2d(torch::nn::Conv2dOptions(filters, filters, 1).stride(1)));
+        register_module("batchNormPointwise2", batchNormPointwise2 = torch::nn::BatchNorm2d(filters));
+
+        if (squeezeExcitation)
+        {
+            int const squeezed = std::max(filters / 4, 1);
+            register_module("squeeze", squeeze = torch::nn::Linear(filters, squeezed));
+            register_module("excite", excite = torch::nn::Linear(squeezed, filters));
+        }
+    }
+
+    /**
+     * @brief Method to make a forward pass through the neural network
+     *
+     * @param input: the input tensor
+     * @return torch::Tensor: the output tensor
+     */
+    torch::Tensor forward(torch::Tensor const& input) override
+    {
+        torch::Tensor x;
+        if (fusedDepthwise1.isFolded())
+        {
+            x = fusedDepthwise1.forward(input).relu_();
+            x = fusedPointwise1.forward(x).relu_();
+            x = fusedDepthwise2.forward(x).relu_();
+            x = fusedPointwise2.forward(x);
+        }
+        else
+        {
+            x = torch::relu(batchNormDepthwise1(depthwise1(input)));
+            x = torch::relu(batchNormPointwise1(pointwise1(x)));
+            x = torch::relu(batchNormDepthwise2(depthwise2(x)));
+            x = batchNormPointwise2(pointwise2(x));
+        }
+
+        if (!squeeze.is_empty())
+        {
+            // average every filter over the board, and scale the filters by what that says about the position
+            torch::Tensor weights = torch::adaptive_avg_pool2d(x, {1, 1}).flatten(1);
+            weights               = torch::sigmoid(excite(torch::relu(squeeze(weights))));
+            x                     = x * weights.view({-1, m_Filters, 1, 1});
+        }
+        // skip connection, then relu
+        return torch::relu(x + input);
+    }
+
+    /**
+     * @brief Fold the batch normalisations into the convolutions, for inference
+     *
+     */
+    void fuse() override
+    {
+        fusedDepthwise1.fold(depthwise1, batchNormDepthwise1, 1, m_Filters);
+        fusedPointwise1.fold(pointwise1, batchNormPointwise1, 0);
+        fusedDepthwise2.fold(depthwise2, batchNormDepthwise2, 1, m_Filters);
+        fusedPointwise2.fold(pointwise2, batchNormPointwise2, 0);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fusedDepthwise1.clear();
+            fusedPointwise1.clear();
+            fusedDepthwise2.clear();
+            fusedPointwise2.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
+    torch::nn::Conv2d      depthwise1 = nullptr, pointwise1 = nullptr, depthwise2 = nullptr, pointwise2 = nullptr;
+    torch::nn::BatchNorm2d batchNormDepthwise1 = nullptr, batchNormPointwise1 = nullptr;
+    torch::nn::BatchNorm2d batchNormDepthwise2 = nullptr, batchNormPointwise2 = nullptr;
+    // squeeze-and-excitation, empty if disabled
+    torch::nn::Linear squeeze = nullptr, excite = nullptr;
+    FusedConv         fusedDepthwise1, fusedPointwise1, fusedDepthwise2, fusedPointwise2;
+
+  private:
+    int64_t m_Filters;
+};
+TORCH_MODULE(DepthwiseBlock);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../common.hpp"
+
+/**
+ * @brief A convolution with the batch normalisation after it folded into its weights and bias.
+ * The batch norm's running statistics are baked in, so it is only valid for inference.
+ *
+ */
+struct FusedConv
+{
+    /**
+     * @brief Fold the batch norm into a copy of the convolution's weights and bias
+     *
+     * @param conv: the convolution
+     * @param batchNorm: the batch norm applied to the convolution's output
+     * @param padding: the padding of the convolution
+     * @param groups: the groups of the convolution, the amount of channels for a depthwise convolution
+     */
+    void fold(torch::nn::Conv2d const& conv, torch::nn::BatchNorm2d const& batchNorm, int64_t padding, int64_t groups = 1)
+    {
+        torch::NoGradGuard noGrad;
+        // batchNorm(x) = (x - mean) * gamma / sqrt(var + eps) + beta, per output channel
+        torch::Tensor scale = batchNorm->weight / (batchNorm->running_var + batchNorm->options.eps()).sqrt();
+
+        m_Weight  = conv->weight * scale.view({-1, 1, 1, 1});
+        m_Bias    = (conv->bias - batchNorm->running_mean) * scale + batchNorm->bias;
+        m_Padding = padding;
+        m_Groups  = groups;
+    }
+
+    /**
+     * @brief Forget the folded weights, e.g. because the originals are about to be trained
+     *
+     */
+    void clear()
+    {
+        m_Weight = torch::Tensor();
+        m_Bias   = torch::Tensor();
+    }
+
+    /**
+     * @brief Check whether the batch norm has been folded in
+     *
+     * @return true if forward can be used
+     */
+    bool isFolded() const
+    {
+        return m_Weight.defined();
+    }
+
+    /**
+     * @brief The convolution followed by the batch norm, as a single convolution
+     *
+     * @param input: the input tensor
+     * @return torch::Tensor: the output tensor
+     */
+    torch::Tensor forward(torch::Tensor const& input) const
+    {
+        return torch::conv2d(input, m_Weight, m_Bias, {1, 1}, {m_Padding, m_Padding}, {1, 1}, m_Groups);
+    }
+
+    torch::Tensor const& getWeight() const
+    {
+        return m_Weight;
+    }
+
+    torch::Tensor const& getBias() const
+    {
+        return m_Bias;
+    }
+
+    int64_t getPadding() const
+    {
+        return m_Padding;
+    }
+
+  private:
+    torch::Tensor m_Weight;
+    torch::Tensor m_Bias;
+    int64_t       m_Padding = 0;
+    int64_t       m_Groups  = 1;
+};
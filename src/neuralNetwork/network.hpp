@@ -4,7 +4,10 @@
 
 #include <tuple>
 
+#include "blockType.hpp"
+#include "bottleneckBlock.hpp"
 #include "convBlock.hpp"
+#include "depthwiseBlock.hpp"
 #include "policyHead.hpp"
 #include "residualBlock.hpp"
 #include "valueHead.hpp"
@@ -22,33 +25,37 @@ struct NetworkImpl : public torch::nn::Module
      * @param width the width of each plane
      * @param height the height of each plane
      * @param outputs the amount of policy outputs
+     * @param blocks the amount of residual blocks
      * @param filters the amount of convolutional filters each layer
      * @param policyFilters the amount of filters in the policy layers
      * @param valueFilters the amount of filters in the value layers
+     * @param blockType the kind of residual blocks
      */
-    NetworkImpl(int planes, int width, int height, int outputs, int filters, int policyFilters, int valueFilters)
+    NetworkImpl(int planes, int width, int height, int outputs, int blocks, int filters, int policyFilters, int valueFilters,
+                eBlockType blockType = eBlockType::RESIDUAL)
+      : m_Architecture({blocks, filters, policyFilters, valueFilters, (int64_t)blockType})
     {
         convInput = register_module("convInput", ConvBlock(planes, filters));
 
-        resBlock1  = register_module("resBlock1", ResidualBlock(filters, filters, filters));
-        resBlock2  = register_module("resBlock2", ResidualBlock(filters, filters, filters));
-        resBlock3  = register_module("resBlock3", ResidualBlock(filters, filters, filters));
-        resBlock4  = register_module("resBlock4", ResidualBlock(filters, filters, filters));
-        resBlock5  = register_module("resBlock5", ResidualBlock(filters, filters, filters));
-        resBlock6  = register_module("resBlock6", ResidualBlock(filters, filters, filters));
-        resBlock7  = register_module("resBlock7", ResidualBlock(filters, filters, filters));
-        resBlock8  = register_module("resBlock8", ResidualBlock(filters, filters, filters));
-        resBlock9  = register_module("resBlock9", ResidualBlock(filters, filters, filters));
-        resBlock10 = register_module("resBlock10", ResidualBlock(filters, filters, filters));
-        resBlock11 = register_module("resBlock11", ResidualBlock(filters, filters, filters));
-        resBlock12 = register_module("resBlock12", ResidualBlock(filters, filters, filters));
-        resBlock13 = register_module("resBlock13", ResidualBlock(filters, filters, filters));
-        resBlock14 = register_module("resBlock14", ResidualBlock(filters, filters, filters));
-        resBlock15 = register_module("resBlock15", ResidualBlock(filters, filters, filters));
-        resBlock16 = register_module("resBlock16", ResidualBlock(filters, filters, filters));
-        resBlock17 = register_module("resBlock17", ResidualBlock(filters, filters, filters));
-        resBlock18 = register_module("resBlock18", ResidualBlock(filters, filters, filters));
-        resBlock19 = register_module("resBlock19", ResidualBlock(filters, filters, filters));
+        resBlocks = register_module("resBlocks", torch::nn::ModuleList());
+        for (int i = 0; i < blocks; i++)
+        {
+            switch (blockType)
+            {
+                case eBlockType::RESIDUAL:
+                    resBlocks->push_back(ResidualBlock(filters, filters, filters));
+                    break;
+                case eBlockType::BOTTLENECK:
+                    resBlocks->push_back(BottleneckBlock(filters, std::max(filters / 4, 1)));
+                    break;
+                case eBlockType::DEPTHWISE:
+                    resBlocks->push_back(DepthwiseBlock(filters, false));
+                    break;
+                case eBlockType::DEPTHWISE_SE:
+                    resBlocks->push_back(DepthwiseBlock(filters, true));
+                    break;
+            }
+        }
 
         valueHead  = register_module("valueHead", ValueHead(filters, valueFilters, width, height, filters));
         policyHead = register_module("policyHead", PolicyHead(filters, policyFilters, width, height, outputs));
@@ -59,52 +66,114 @@ struct NetworkImpl : public torch::nn::Module
         // the first convolutional layer
         auto x = convInput(input);
         // all residual blocks
-        x = resBlock1(x);
-        x = resBlock2(x);
-        x = resBlock3(x);
-        x = resBlock4(x);
-        x = resBlock5(x);
-        x = resBlock6(x);
-        x = resBlock7(x);
-        x = resBlock8(x);
-        x = resBlock9(x);
-        x = resBlock10(x);
-        x = resBlock11(x);
-        x = resBlock12(x);
-        x = resBlock13(x);
-        x = resBlock14(x);
-        x = resBlock15(x);
-        x = resBlock16(x);
-        x = resBlock17(x);
-        x = resBlock18(x);
-        x = resBlock19(x);
+        for (auto const& block: *resBlocks)
+        {
+            x = block->as<TrunkBlock>()->forward(x);
+        }
         // return the two outputs
         return std::make_pair(policyHead(x), valueHead(x));
     }
 
-    ConvBlock     convInput  = nullptr;
-    ResidualBlock resBlock1  = nullptr;
-    ResidualBlock resBlock2  = nullptr;
-    ResidualBlock resBlock3  = nullptr;
-    ResidualBlock resBlock4  = nullptr;
-    ResidualBlock resBlock5  = nullptr;
-    ResidualBlock resBlock6  = nullptr;
-    ResidualBlock resBlock7  = nullptr;
-    ResidualBlock resBlock8  = nullptr;
-    ResidualBlock resBlock9  = nullptr;
-    ResidualBlock resBlock10 = nullptr;
-    ResidualBlock resBlock11 = nullptr;
-    ResidualBlock resBlock12 = nullptr;
-    ResidualBlock resBlock13 = nullptr;
-    ResidualBlock resBlock14 = nullptr;
-    ResidualBlock resBlock15 = nullptr;
-    ResidualBlock resBlock16 = nullptr;
-    ResidualBlock resBlock17 = nullptr;
-    ResidualBlock resBlock18 = nullptr;
-    ResidualBlock resBlock19 = nullptr;
-
-    PolicyHead policyHead = nullptr;
-    ValueHead  valueHead  = nullptr;
+    /**
+     * @brief Fold every batch normalisation into the convolution before it, for inference.
+     * Switching to training mode drops the folded weights again.
+     *
+     */
+    void fuse()
+    {
+        convInput->fuse();
+        for (auto const& block: *resBlocks)
+        {
+            block->as<TrunkBlock>()->fuse();
+        }
+        valueHead->fuse();
+        policyHead->fuse();
+    }
+
+    /**
+     * @brief Get the residual block at the given index, only for networks of plain residual blocks
+     *
+     * @param index: the index in the trunk
+     * @return ResidualBlockImpl&
+     */
+    ResidualBlockImpl& getBlock(size_t index)
+    {
+        return resBlocks->at<ResidualBlockImpl>(index);
+    }
+
+    /**
+     * @brief Get the sizes the network was built with, which are saved with its weights
+     *
+     * @return std::vector<int64_t>: the amount of residual blocks, filters, policy filters, value filters and the block type
+     */
+    std::vector<int64_t> const& getArchitecture() const
+    {
+        return m_Architecture;
+    }
+
+    /**
+     * @brief Get the kind of residual blocks of the trunk
+     *
+     * @return eBlockType
+     */
+    eBlockType getBlockType() const
+    {
+        return (eBlockType)m_Architecture[4];
+    }
+
+    /**
+     * @brief Count the multiplications and additions of evaluating a single position
+     *
+     * @param width the width of the board
+     * @param height the height of the board
+     * @return int64_t: the amount of floating point operations
+     */
+    int64_t countFlops(int width, int height) const
+    {
+        int64_t flops = 0;
+        for (auto const& module: modules())
+        {
+            // every convolution keeps the board size, so each weight is used once per square
+            if (auto conv = std::dynamic_pointer_cast<torch::nn::Conv2dImpl>(module))
+            {
+                flops += 2 * conv->weight.numel() * width * height;
+            }
+            else if (auto linear = std::dynamic_pointer_cast<torch::nn::LinearImpl>(module))
+            {
+                flops += 2 * linear->weight.numel();
+            }
+        }
+        return flops;
+    }
+
+    /**
+     * @brief Load the weights of a model saved before the trunk was a list, with 19 blocks named resBlock1 to resBlock19
+     *
+     * @param archive: the archive of the saved model
+     */
+    void loadLegacy(torch::serialize::InputArchive& archive)
+    {
+        auto loadChild = [&archive](std::string const& name, torch::nn::Module& module) {
+            torch::serialize::InputArchive child;
+            archive.read(name, child);
+            module.load(child);
+        };
+        loadChild("convInput", *convInput);
+        for (size_t i = 0; i < resBlocks->size(); i++)
+        {
+            loadChild("resBlock" + std::to_string(i + 1), getBlock(i));
+        }
+        loadChild("valueHead", *valueHead);
+        loadChild("policyHead", *policyHead);
+    }
+
+    ConvBlock             convInput  = nullptr;
+    torch::nn::ModuleList resBlocks  = nullptr;
+    PolicyHead            policyHead = nullptr;
+    ValueHead             valueHead  = nullptr;
+
+  private:
+    std::vector<int64_t> m_Architecture;
 };
 
 TORCH_MODULE(Network);
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../common.hpp"
+#include "fusedConv.hpp"
 
 /**
  * @brief The policy output architecture of the AlphaZero network
@@ -37,9 +38,17 @@ struct PolicyHeadImpl : public torch::nn::Module
         int64_t batch_size = input.size(0);
 
         // conv block
-        auto pol = convPolicy(input);
-        pol      = batchNormPolicy(pol);
-        pol      = torch::relu(pol);
+        torch::Tensor pol;
+        if (fusedPolicy.isFolded())
+        {
+            pol = fusedPolicy.forward(input).relu_();
+        }
+        else
+        {
+            pol = convPolicy(input);
+            pol = batchNormPolicy(pol);
+            pol = torch::relu(pol);
+        }
 
         // flatten
         pol = pol.view({batch_size, -1});
@@ -52,9 +61,33 @@ struct PolicyHeadImpl : public torch::nn::Module
         return pol;
     }
 
+    /**
+     * @brief Fold the batch normalisation into the convolution, for inference
+     *
+     */
+    void fuse()
+    {
+        fusedPolicy.fold(convPolicy, batchNormPolicy, 0);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fusedPolicy.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
   private:
     torch::nn::Conv2d      convPolicy      = nullptr;
     torch::nn::BatchNorm2d batchNormPolicy = nullptr;
     torch::nn::Linear      linearPolicy    = nullptr;
+    FusedConv              fusedPolicy;
 };
 TORCH_MODULE(PolicyHead);
@@ -0,0 +1,145 @@
+#include "quantizedNetwork.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// the quantized operators are only registered with the dispatcher, not as torch:: functions
+c10::IValue callOperator(c10::OperatorHandle const & op, torch::jit::Stack stack)
+{
+    op.callBoxed(&stack);
+    return stack.front();
+}
+} // namespace
+
+QuantizedNetwork::QuantizedNetwork(Network net, torch::Tensor const & calibration)
+  : m_Net(net)
+{
+    torch::NoGradGuard noGrad;
+    if (m_Net->getBlockType() != eBlockType::RESIDUAL)
+    {
+        throw std::runtime_error("only networks of residual blocks can be quantized, not " + blockTypeToString(m_Net->getBlockType()));
+    }
+
+    m_Input = createLayer(m_Net->convInput->fused1, true);
+    for (size_t i = 0; i < m_Net->resBlocks->size(); i++)
+    {
+        ResidualBlockImpl const & block = m_Net->getBlock(i);
+        m_Blocks.push_back({createLayer(block.fused1, true), createLayer(block.fused2, false)});
+    }
+
+    // run the calibration positions through the folded fp32 trunk to find the range of every activation
+    Range              inputRange;
+    Range              firstRange;
+    std::vector<Range> conv1Ranges(m_Blocks.size());
+    std::vector<Range> conv2Ranges(m_Blocks.size());
+    std::vector<Range> blockRanges(m_Blocks.size());
+
+    torch::Tensor x = calibration.to(torch::kCPU).to(torch::kFloat32);
+    inputRange.observe(x);
+    x = floatConv(m_Input, x);
+    firstRange.observe(x);
+    for (size_t i = 0; i < m_Blocks.size(); i++)
+    {
+        torch::Tensor y = floatConv(m_Blocks[i].conv1, x);
+        conv1Ranges[i].observe(y);
+        y = floatConv(m_Blocks[i].conv2, y);
+        conv2Ranges[i].observe(y);
+        x = torch::relu(y + x);
+        blockRanges[i].observe(x);
+    }
+
+    m_InputScale     = inputRange.scale();
+    m_InputZeroPoint = inputRange.zeroPoint();
+    quantizeLayer(m_Input, firstRange);
+    for (size_t i = 0; i < m_Blocks.size(); i++)
+    {
+        quantizeLayer(m_Blocks[i].conv1, conv1Ranges[i]);
+        quantizeLayer(m_Blocks[i].conv2, conv2Ranges[i]);
+        m_Blocks[i].scale     = blockRanges[i].scale();
+        m_Blocks[i].zeroPoint = blockRanges[i].zeroPoint();
+    }
+    LINFO << "Quantized " << 1 + 2 * m_Blocks.size() << " convolutions to int8, calibrated on " << calibration.size(0) << " positions";
+}
+
+std::pair<torch::Tensor, torch::Tensor> QuantizedNetwork::forward(torch::Tensor const & input) const
+{
+    static c10::OperatorHandle const addRelu = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::add_relu", "");
+
+    // the quantized engine works on channels last
+    torch::Tensor x = input.to(torch::kCPU).contiguous(torch::MemoryFormat::ChannelsLast);
+    x               = torch::quantize_per_tensor(x, m_InputScale, m_InputZeroPoint, torch::kQUInt8);
+    x               = quantizedConv(m_Input, x);
+    for (Block const & block: m_Blocks)
+    {
+        torch::Tensor y = quantizedConv(block.conv1, x);
+        y               = quantizedConv(block.conv2, y);
+        x               = callOperator(addRelu, {y, x, block.scale, block.zeroPoint}).toTensor();
+    }
+
+    // the heads are a small part of the work, and the softmax & tanh need the precision
+    torch::Tensor trunk = x.dequantize().contiguous();
+    return std::make_pair(m_Net->policyHead(trunk), m_Net->valueHead(trunk));
+}
+
+void QuantizedNetwork::Range::observe(torch::Tensor const & activation)
+{
+    min = std::min(min, activation.min().item<float>());
+    max = std::max(max, activation.max().item<float>());
+}
+
+double QuantizedNetwork::Range::scale() const
+{
+    // the range always contains 0, so it can be represented exactly
+    return std::max((double)(max - min) / 255.0, 1e-8);
+}
+
+int64_t QuantizedNetwork::Range::zeroPoint() const
+{
+    return std::clamp<int64_t>(std::lround(-min / scale()), 0, 255);
+}
+
+QuantizedNetwork::Layer QuantizedNetwork::createLayer(FusedConv const & fused, bool relu)
+{
+    if (!fused.isFolded())
+    {
+        LFATAL << "Only a network with folded batch norms can be quantized";
+    }
+    Layer layer;
+    layer.weight  = fused.getWeight().to(torch::kCPU);
+    layer.bias    = fused.getBias().to(torch::kCPU);
+    layer.padding = fused.getPadding();
+    layer.relu    = relu;
+    return layer;
+}
+
+void QuantizedNetwork::quantizeLayer(Layer & layer, Range const & range)
+{
+    static c10::OperatorHandle const prepack = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::conv2d_prepack", "");
+
+    // symmetric int8 per output channel
+    torch::Tensor scales     = (layer.weight.abs().amax({1, 2, 3}) / 127.0).clamp_min(1e-8).to(torch::kDouble);
+    torch::Tensor zeroPoints = torch::zeros({layer.weight.size(0)}, torch::kLong);
+    torch::Tensor weight     = torch::quantize_per_channel(layer.weight, scales, zeroPoints, 0, torch::kQInt8);
+
+    std::vector<int64_t> const stride   = {1, 1};
+    std::vector<int64_t> const padding  = {layer.padding, layer.padding};
+    std::vector<int64_t> const dilation = {1, 1};
+    layer.packed    = callOperator(prepack, {weight, layer.bias, stride, padding, dilation, (int64_t)1});
+    layer.scale     = range.scale();
+    layer.zeroPoint = range.zeroPoint();
+}
+
+torch::Tensor QuantizedNetwork::floatConv(Layer const & layer, torch::Tensor const & input)
+{
+    torch::Tensor output = torch::conv2d(input, layer.weight, layer.bias, {1, 1}, {layer.padding, layer.padding});
+    return layer.relu ? output.relu_() : output;
+}
+
+torch::Tensor QuantizedNetwork::quantizedConv(Layer const & layer, torch::Tensor const & input)
+{
+    static c10::OperatorHandle const conv     = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::conv2d", "new");
+    static c10::OperatorHandle const convRelu = c10::Dispatcher::singleton().findSchemaOrThrow("quantized::conv2d_relu", "new");
+    return callOperator(layer.relu ? convRelu : conv, {input, layer.packed, layer.scale, layer.zeroPoint}).toTensor();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <ATen/core/dispatch/Dispatcher.h>
+
+#include "../common.hpp"
+#include "network.hpp"
+
+/**
+ * @brief The residual trunk of a Network with int8 weights and activations, for fast inference on the CPU.
+ * The convolution weights are quantized per output channel, the activations per tensor, with ranges
+ * measured on a set of calibration positions. The small policy and value heads run in fp32.
+ *
+ */
+class QuantizedNetwork
+{
+  public:
+    /**
+     * @brief Quantize the trunk of a network whose batch norms are folded into its convolutions
+     *
+     * @param net: the network, in evaluation mode and fused
+     * @param calibration: a batch of input positions, to measure the range of every activation
+     */
+    QuantizedNetwork(Network net, torch::Tensor const & calibration);
+
+    /**
+     * @brief Run inference with the int8 trunk
+     *
+     * @param input: the input positions
+     * @return std::pair<torch::Tensor, torch::Tensor>: two outputs: policy & value output
+     */
+    std::pair<torch::Tensor, torch::Tensor> forward(torch::Tensor const & input) const;
+
+  private:
+    /**
+     * @brief A folded convolution, with its quantized weights and output range
+     *
+     */
+    struct Layer
+    {
+        torch::Tensor weight;
+        torch::Tensor bias;
+        int64_t       padding   = 0;
+        bool          relu      = false;
+        c10::IValue   packed; // int8 weights, prepacked for the quantized engine
+        double        scale     = 1.0;
+        int64_t       zeroPoint = 0;
+    };
+
+    /**
+     * @brief Two convolutions with a skip connection, the sum is requantized to its own range
+     *
+     */
+    struct Block
+    {
+        Layer   conv1;
+        Layer   conv2;
+        double  scale     = 1.0;
+        int64_t zeroPoint = 0;
+    };
+
+    /**
+     * @brief Range of an activation over the calibration positions
+     *
+     */
+    struct Range
+    {
+        float min = 0.0f;
+        float max = 0.0f;
+
+        void    observe(torch::Tensor const & activation);
+        double  scale() const;
+        int64_t zeroPoint() const;
+    };
+
+    static Layer         createLayer(FusedConv const & fused, bool relu);
+    static void          quantizeLayer(Layer & layer, Range const & range);
+    static torch::Tensor floatConv(Layer const & layer, torch::Tensor const & input);
+    static torch::Tensor quantizedConv(Layer const & layer, torch::Tensor const & input);
+
+    Network            m_Net            = nullptr;
+    double             m_InputScale     = 1.0;
+    int64_t            m_InputZeroPoint = 0;
+    Layer              m_Input;
+    std::vector<Block> m_Blocks;
+};
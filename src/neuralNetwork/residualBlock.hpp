@@ -1,12 +1,14 @@
 #pragma once
 
 #include "../common.hpp"
+#include "fusedConv.hpp"
+#include "trunkBlock.hpp"
 
 /**
  * @brief A residual block consists of multiple convolutional layers with skip connections.
  *
  */
-struct ResidualBlockImpl : public torch::nn::Module
+struct ResidualBlockImpl : public TrunkBlock
 {
     /**
      * @brief Construct a new residual block
@@ -30,8 +32,15 @@ struct ResidualBlockImpl : public torch::nn::Module
      * @param input: the input tensor
      * @return torch::Tensor: the output tensor
      */
-    torch::Tensor forward(torch::Tensor const& input)
+    torch::Tensor forward(torch::Tensor const& input) override
     {
+        if (fused1.isFolded())
+        {
+            torch::Tensor x = fused1.forward(input).relu_();
+            x               = fused2.forward(x);
+            // in place: the skip connection and relu don't need a new tensor each
+            return x.add_(input).relu_();
+        }
         torch::Tensor x = input;
         // first conv block
         x = batchNorm1(conv1(input));
@@ -43,7 +52,33 @@ struct ResidualBlockImpl : public torch::nn::Module
         return x;
     }
 
+    /**
+     * @brief Fold the batch normalisations into the convolutions, for inference
+     *
+     */
+    void fuse() override
+    {
+        fused1.fold(conv1, batchNorm1, 1);
+        fused2.fold(conv2, batchNorm2, 1);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fused1.clear();
+            fused2.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
     torch::nn::Conv2d      conv1 = nullptr, conv2 = nullptr;
     torch::nn::BatchNorm2d batchNorm1 = nullptr, batchNorm2 = nullptr;
+    FusedConv              fused1, fused2;
 };
 TORCH_MODULE(ResidualBlock);
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../common.hpp"
+
+/**
+ * @brief A block of the network's trunk. Every kind of block keeps the amount of filters,
+ * so they can be stacked in the same trunk.
+ *
+ */
+struct TrunkBlock : public torch::nn::Module
+{
+    /**
+     * @brief Method to make a forward pass through the block
+     *
+     * @param input: the input tensor
+     * @return torch::Tensor: the output tensor, of the same shape
+     */
+    virtual torch::Tensor forward(torch::Tensor const& input) = 0;
+
+    /**
+     * @brief Fold the batch normalisations into the convolutions, for inference
+     *
+     */
+    virtual void fuse() = 0;
+};
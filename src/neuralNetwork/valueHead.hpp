@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../common.hpp"
+#include "fusedConv.hpp"
 
 /**
  * @brief The value output architecture of the AlphaZero network
@@ -39,9 +40,17 @@ struct ValueHeadImpl : public torch::nn::Module
         int64_t size = input.size(0);
 
         // conv, batch norm, relu
-        auto value = convValue(input);
-        value      = batchNormValue(value);
-        value      = torch::relu(value);
+        torch::Tensor value;
+        if (fusedValue.isFolded())
+        {
+            value = fusedValue.forward(input).relu_();
+        }
+        else
+        {
+            value = convValue(input);
+            value = batchNormValue(value);
+            value = torch::relu(value);
+        }
 
         // flatten, linear, relu
         value = value.view({size, -1});
@@ -55,10 +64,34 @@ struct ValueHeadImpl : public torch::nn::Module
         return value;
     }
 
+    /**
+     * @brief Fold the batch normalisation into the convolution, for inference
+     *
+     */
+    void fuse()
+    {
+        fusedValue.fold(convValue, batchNormValue, 0);
+    }
+
+    /**
+     * @brief Switch between training and evaluation mode, training drops the folded weights
+     *
+     * @param on: true for training mode
+     */
+    void train(bool on = true) override
+    {
+        if (on)
+        {
+            fusedValue.clear();
+        }
+        torch::nn::Module::train(on);
+    }
+
   private:
     torch::nn::Conv2d      convValue      = nullptr;
     torch::nn::BatchNorm2d batchNormValue = nullptr;
     torch::nn::Linear      linearValue1   = nullptr;
     torch::nn::Linear      linearValue2   = nullptr;
+    FusedConv              fusedValue;
 };
 TORCH_MODULE(ValueHead);
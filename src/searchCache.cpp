@@ -0,0 +1,38 @@
+#include "searchCache.hpp"
+
+#include "evaluationStore.hpp"
+
+bool SearchCache::lookup(std::string const & agent, std::shared_ptr<Environment> const & env, int & move)
+{
+    auto it = m_Moves.find(makeKey(agent, env));
+    if (it == m_Moves.end())
+    {
+        m_Misses++;
+        return false;
+    }
+    m_Hits++;
+    move = it->second;
+    return true;
+}
+
+void SearchCache::store(std::string const & agent, std::shared_ptr<Environment> const & env, int move)
+{
+    m_Moves[makeKey(agent, env)] = move;
+}
+
+int SearchCache::getHits() const
+{
+    return m_Hits;
+}
+
+void SearchCache::logStatistics() const
+{
+    int lookups = m_Hits + m_Misses;
+    LINFO << "Search cache: " << m_Hits << " of " << lookups << " searches skipped, " << m_Moves.size() << " positions cached";
+}
+
+std::string SearchCache::makeKey(std::string const & agent, std::shared_ptr<Environment> const & env)
+{
+    // the position itself, so transpositions from other openings or colors hit as well
+    return agent + ":" + std::to_string(EvaluationStore::positionKey(env));
+}
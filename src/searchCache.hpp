@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "connect4/environment.hpp"
+
+/**
+ * @brief Remembers the move a deterministic search chose in a position, so games that reach
+ * the same position (e.g. through another move order in a model evaluation) don't have to search it again.
+ * Positions are identified by their board and player to move, not by the moves that lead to them.
+ * One cache should only be used within a single match, with the same settings for every game.
+ */
+class SearchCache
+{
+  public:
+    /**
+     * @brief Get the move that was chosen before by the given agent in the given position
+     *
+     * @param agent: the name of the agent that is searching
+     * @param env: the position
+     * @param move: set to the cached move if there is one
+     * @return true if the move was cached
+     */
+    bool lookup(std::string const & agent, std::shared_ptr<Environment> const & env, int & move);
+
+    /**
+     * @brief Remember the move the given agent chose in the given position
+     *
+     * @param agent: the name of the agent that searched
+     * @param env: the position
+     * @param move: the chosen move
+     */
+    void store(std::string const & agent, std::shared_ptr<Environment> const & env, int move);
+
+    /**
+     * @brief Get the amount of lookups that found a move
+     *
+     * @return int
+     */
+    int getHits() const;
+
+    /**
+     * @brief Log the amount of hits and misses
+     */
+    void logStatistics() const;
+
+  private:
+    /**
+     * @brief Create the key of a position searched by the given agent
+     *
+     * @param agent: the name of the agent
+     * @param env: the position
+     * @return std::string: the key
+     */
+    static std::string makeKey(std::string const & agent, std::shared_ptr<Environment> const & env);
+
+    std::unordered_map<std::string, int> m_Moves;
+    int                                  m_Hits   = 0;
+    int                                  m_Misses = 0;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief The game-theoretic result of a Node, once it is known.
+ * Seen from the player who made the move to get to the Node, like the Node's value.
+ *
+ */
+enum class eProof : uint8_t
+{
+    UNKNOWN = 0,
+    WIN     = 1,
+    LOSS    = 2,
+    DRAW    = 3
+};
+
+#ifdef C4_COMPACT_NODES
+
+/**
+ * @brief The search statistics of the edge (move) into a Node, packed for long analysis searches:
+ * the prior is stored as a half-precision float, and the move, proof and terminal flag share 16 bits.
+ *
+ */
+class EdgeStats
+{
+  public:
+    float   value  = 0.0f; // sum of all backpropagated values
+    int32_t visits = 0;
+
+    float getPrior() const
+    {
+        return halfToFloat(m_Prior);
+    }
+    void setPrior(float prior)
+    {
+        m_Prior = floatToHalf(prior);
+    }
+
+    int getMove() const
+    {
+        int move = m_Packed & moveMask;
+        return move == noMove ? -1 : move;
+    }
+    void setMove(int move)
+    {
+        m_Packed = (uint16_t)((m_Packed & ~moveMask) | (move < 0 ? noMove : (uint16_t)move));
+    }
+
+    eProof getProof() const
+    {
+        return static_cast<eProof>((m_Packed >> proofShift) & 0x3);
+    }
+    void setProof(eProof proof)
+    {
+        m_Packed = (uint16_t)((m_Packed & ~(0x3 << proofShift)) | ((uint16_t)proof << proofShift));
+    }
+
+    bool isTerminal() const
+    {
+        return (m_Packed & terminalBit) != 0;
+    }
+    void setTerminal(bool terminal)
+    {
+        m_Packed = (uint16_t)(terminal ? m_Packed | terminalBit : m_Packed & ~terminalBit);
+    }
+
+  private:
+    // bits 0-3: move (15 = no move), bits 4-5: proof, bit 6: terminal
+    static constexpr uint16_t moveMask    = 0x000F;
+    static constexpr uint16_t noMove      = 0x000F;
+    static constexpr int      proofShift  = 4;
+    static constexpr uint16_t terminalBit = 0x0040;
+
+    /**
+     * @brief Convert a float to IEEE half precision, rounding to nearest even.
+     * Priors are in [0, 1], so only the normal and subnormal range matter.
+     *
+     */
+    static uint16_t floatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign     = (uint16_t)((bits >> 16) & 0x8000);
+        int      exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+        uint32_t mantissa = bits & 0x007FFFFF;
+        if (exponent >= 31)
+        {
+            // too large (or inf/nan): clamp to the largest finite half
+            return (uint16_t)(sign | 0x7BFF);
+        }
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+            {
+                return sign;
+            }
+            // subnormal: shift in the implicit leading one
+            mantissa |= 0x00800000;
+            int      shift   = 14 - exponent;
+            uint32_t half    = mantissa >> shift;
+            uint32_t rest    = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (rest > halfway || (rest == halfway && (half & 1)))
+            {
+                half++;
+            }
+            return (uint16_t)(sign | half);
+        }
+        uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        uint32_t rest = mantissa & 0x1FFF;
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        {
+            // may carry into the exponent, which is still correct
+            half++;
+        }
+        return (uint16_t)(sign | std::min<uint32_t>(half, 0x7BFF));
+    }
+
+    static float halfToFloat(uint16_t half)
+    {
+        uint32_t sign     = (uint32_t)(half & 0x8000) << 16;
+        int      exponent = (half >> 10) & 0x1F;
+        uint32_t mantissa = half & 0x03FF;
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            if (mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                // subnormal: normalize
+                exponent = 1;
+                while ((mantissa & 0x0400) == 0)
+                {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                mantissa &= 0x03FF;
+                bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+            }
+        }
+        else
+        {
+            bits = sign | ((uint32_t)(exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint16_t m_Prior  = 0;
+    uint16_t m_Packed = noMove;
+};
+static_assert(sizeof(EdgeStats) == 12, "compact EdgeStats must stay 12 bytes");
+
+#else
+
+/**
+ * @brief The search statistics of the edge (move) into a Node
+ *
+ */
+class EdgeStats
+{
+  public:
+    float   value  = 0.0f; // sum of all backpropagated values
+    int32_t visits = 0;
+
+    float getPrior() const
+    {
+        return m_Prior;
+    }
+    void setPrior(float prior)
+    {
+        m_Prior = prior;
+    }
+
+    int getMove() const
+    {
+        return m_Move;
+    }
+    void setMove(int move)
+    {
+        m_Move = (int8_t)move;
+    }
+
+    eProof getProof() const
+    {
+        return m_Proof;
+    }
+    void setProof(eProof proof)
+    {
+        m_Proof = proof;
+    }
+
+    bool isTerminal() const
+    {
+        return m_Terminal;
+    }
+    void setTerminal(bool terminal)
+    {
+        m_Terminal = terminal;
+    }
+
+  private:
+    float  m_Prior    = 0.0f;
+    int8_t m_Move     = -1;
+    bool   m_Terminal = false;
+    eProof m_Proof    = eProof::UNKNOWN;
+};
+static_assert(sizeof(EdgeStats) == 16, "EdgeStats must stay 16 bytes");
+
+#endif
@@ -3,9 +3,9 @@
 Node::Node(Node * parent, std::shared_ptr<Environment> env, int move, float prior)
   : m_Parent(parent)
   , m_Environment(env)
-  , m_Move(move)
-  , m_Prior(prior)
 {
+    m_Stats.setMove(move);
+    m_Stats.setPrior(prior);
 }
 
 Node::Node(std::shared_ptr<Environment> env)
@@ -16,7 +16,17 @@ Node::Node(std::shared_ptr<Environment> env)
 
 Node::~Node() {}
 
-std::vector<std::unique_ptr<Node>> const & Node::getChildren() const
+void * Node::operator new(size_t size)
+{
+    return NodeStorage::allocateTree(size);
+}
+
+void Node::operator delete(void * pointer, size_t size)
+{
+    NodeStorage::deallocateTree(pointer, size);
+}
+
+Node::Children const & Node::getChildren() const
 {
     return m_Children;
 }
@@ -54,6 +64,27 @@ Node* Node::removeChild(std::unique_ptr<Node> const & child)
     return releasedChild;
 }
 
+void Node::releaseChildren(std::vector<std::unique_ptr<Node>> & children)
+{
+    for (auto & child: m_Children)
+    {
+        children.emplace_back(std::move(child));
+    }
+    // clear() keeps the capacity, so the vector can be reused
+    m_Children.clear();
+}
+
+void Node::reset(Node * parent, std::shared_ptr<Environment> env, int move, float prior)
+{
+    m_Parent      = parent;
+    m_Environment = std::move(env);
+    m_Stats       = EdgeStats();
+    m_Stats.setMove(move);
+    m_Stats.setPrior(prior);
+    m_Evaluation.reset();
+    m_Children.clear();
+}
+
 Node * Node::getParent() const
 {
     return m_Parent;
@@ -66,42 +97,87 @@ void Node::setParent(Node * parent)
 
 std::shared_ptr<Environment> const & Node::getEnvironment() const
 {
+    if (m_Environment == nullptr && m_Parent != nullptr)
+    {
+        // replay the moves from the closest ancestor that has its position, without storing the positions in between
+        std::vector<int> moves    = {getMove()};
+        Node const *     ancestor = m_Parent;
+        while (ancestor->m_Environment == nullptr && ancestor->m_Parent != nullptr)
+        {
+            moves.push_back(ancestor->getMove());
+            ancestor = ancestor->m_Parent;
+        }
+        m_Environment = std::make_shared<Environment>(ancestor->m_Environment);
+        for (auto move = moves.rbegin(); move != moves.rend(); move++)
+        {
+            m_Environment->makeMove(*move);
+        }
+    }
     return m_Environment;
 }
 
+bool Node::hasEnvironment() const
+{
+    return m_Environment != nullptr;
+}
+
+void Node::releaseEnvironment()
+{
+    // a root can't replay its position
+    if (m_Parent != nullptr)
+    {
+        m_Environment.reset();
+    }
+}
+
+bool Node::replaysEnvironments()
+{
+#ifdef C4_COMPACT_NODES
+    return true;
+#else
+    // the node file can't hold positions: they would take heap memory for every node
+    return NodeStorage::getActive() != nullptr;
+#endif
+}
+
 void Node::incrementVisit()
 {
-    m_Visits++;
+    m_Stats.visits++;
+}
+
+void Node::addVisits(int visits)
+{
+    m_Stats.visits += visits;
 }
 
 int Node::getVisits() const
 {
-    return m_Visits;
+    return m_Stats.visits;
 }
 
 float Node::getValue() const
 {
-    return m_Value;
+    return m_Stats.value;
 }
 
 void Node::setValue(float value)
 {
-    m_Value = value;
+    m_Stats.value = value;
 }
 
 float Node::getPrior() const
 {
-    return m_Prior;
+    return m_Stats.getPrior();
 }
 
 void Node::setPrior(float prior)
 {
-    m_Prior = prior;
+    m_Stats.setPrior(prior);
 }
 
 float Node::getQ() const
 {
-    return m_Value / ((float)m_Visits + 1e-3);
+    return m_Stats.value / ((float)m_Stats.visits + 1e-3);
 }
 
 float Node::getU() const
@@ -112,11 +188,80 @@ float Node::getU() const
     }
     // uses the PUCT formula based on AlphaZero's paper and pseudocode
     float exp_rate = log((m_Parent->getVisits() + 19652.0f + 1.0f) / 19652.0f) + 1.25f;
-    exp_rate *= sqrt((float)m_Parent->getVisits()) / ((float)m_Visits + 1e-3);
-    return cpuct * exp_rate * this->m_Prior;
+    exp_rate *= sqrt((float)m_Parent->getVisits()) / ((float)m_Stats.visits + 1e-3);
+    return cpuct * exp_rate * m_Stats.getPrior();
+}
+
+int Node::getMove() const
+{
+    return m_Stats.getMove();
+}
+
+bool Node::isTerminal() const
+{
+    return m_Stats.isTerminal();
+}
+
+void Node::setTerminal(bool terminal)
+{
+    m_Stats.setTerminal(terminal);
+}
+
+eProof Node::getProof() const
+{
+    return m_Stats.getProof();
+}
+
+void Node::setProof(eProof proof)
+{
+    m_Stats.setProof(proof);
 }
 
-int Node::getMove()
+bool Node::isProven() const
 {
-    return m_Move;
+    return m_Stats.getProof() != eProof::UNKNOWN;
+}
+
+float Node::getProvenValue() const
+{
+    switch (m_Stats.getProof())
+    {
+    case eProof::WIN:
+        return 1.0f;
+    case eProof::LOSS:
+        return -1.0f;
+    default:
+        return 0.0f;
+    }
+}
+
+void Node::setEvaluation(torch::Tensor const & policy, float value)
+{
+    m_Evaluation = std::make_unique<std::pair<torch::Tensor, float>>(policy, value);
+}
+
+bool Node::hasEvaluation() const
+{
+    return m_Evaluation != nullptr;
+}
+
+std::pair<torch::Tensor, float> Node::takeEvaluation()
+{
+    std::pair<torch::Tensor, float> evaluation = std::move(*m_Evaluation);
+    m_Evaluation.reset();
+    return evaluation;
+}
+
+size_t Node::getMemoryUsage() const
+{
+    size_t bytes = sizeof(Node) + m_Children.capacity() * sizeof(std::unique_ptr<Node>);
+    if (m_Environment != nullptr)
+    {
+        bytes += m_Environment->getMemoryUsage();
+    }
+    if (m_Evaluation != nullptr)
+    {
+        bytes += sizeof(*m_Evaluation) + m_Evaluation->first.nbytes();
+    }
+    return bytes;
 }
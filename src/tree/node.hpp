@@ -4,6 +4,8 @@
 #include <optional>
 
 #include "../connect4/environment.hpp"
+#include "edgeStats.hpp"
+#include "nodeStorage.hpp"
 
 /**
  * @brief A Node represents a position in the MCTS tree
@@ -12,6 +14,9 @@
 class Node
 {
   public:
+    // the children list is kept in the node storage with the nodes, if there is one
+    using Children = std::vector<std::unique_ptr<Node>, StorageAllocator<std::unique_ptr<Node>>>;
+
     /**
      * @brief Construct a new Node
      *
@@ -31,6 +36,13 @@ class Node
     Node(Node const &);
     Node & operator=(Node const &);
 
+    /**
+     * @brief Allocate a Node in the active NodeStorage, or on the heap if there is none
+     *
+     */
+    static void * operator new(size_t size);
+    static void   operator delete(void * pointer, size_t size);
+
     /**
      * @brief Destroy the Node object
      *
@@ -55,9 +67,9 @@ class Node
      * @brief Get a vector of child nodes for this Node.
      * These represent the resulting positions of all possible moves from the current position.
      *
-     * @return const std::vector<std::unique_ptr<Node>>&
+     * @return const Children&
      */
-    std::vector<std::unique_ptr<Node>> const & getChildren() const;
+    Children const & getChildren() const;
 
     /**
      * @brief Get the child that resulted after making
@@ -77,18 +89,66 @@ class Node
 
     Node* removeChild(std::unique_ptr<Node> const & child);
 
+    /**
+     * @brief Move all children out of this Node, turning it back into a leaf.
+     * Keeps this Node's visits and value.
+     *
+     * @param children: the vector to append the children to
+     */
+    void releaseChildren(std::vector<std::unique_ptr<Node>> & children);
+
+    /**
+     * @brief Reinitialize a recycled Node as if it was newly constructed
+     *
+     * @param parent: The previous Node
+     * @param env: The environment that describes this position
+     * @param move: The action the previous Node made to get here
+     * @param prior: The probability of the action
+     */
+    void reset(Node * parent, std::shared_ptr<Environment> env, int move, float prior);
+
     /**
      * @brief Get this Node's environment.
+     * Without one, it is created from the closest ancestor's environment the first time it is needed,
+     * so even this const getter changes the tree: a tree must only be used by one thread at a time.
      *
      * @return std::shared_ptr<Environment>
      */
     std::shared_ptr<Environment> const & getEnvironment() const;
 
+    /**
+     * @brief Return true if this Node keeps its environment, instead of replaying it when it is needed
+     *
+     * @return bool
+     */
+    bool hasEnvironment() const;
+
+    /**
+     * @brief Drop this Node's environment, getEnvironment() replays it from an ancestor's if needed again.
+     * A root keeps its environment.
+     *
+     */
+    void releaseEnvironment();
+
+    /**
+     * @brief Return true if new children should be created without an environment:
+     * with compact nodes, and when the tree is kept in a node storage
+     *
+     * @return bool
+     */
+    static bool replaysEnvironments();
+
     /**
      * @brief Increment the visit count for this Node.
      *
      */
     void incrementVisit();
+    /**
+     * @brief Add the given amount of visits to this Node, e.g. when merging search results.
+     *
+     * @param visits
+     */
+    void addVisits(int visits);
     /**
      * @brief Get the visit count for this Node.
      *
@@ -141,14 +201,87 @@ class Node
      *
      * @return int
      */
-    int getMove();
+    int getMove() const;
+
+    /**
+     * @brief Return true if the game is over in this position
+     *
+     * @return bool
+     */
+    bool isTerminal() const;
+    /**
+     * @brief Mark this Node as the end of the game
+     *
+     * @param terminal
+     */
+    void setTerminal(bool terminal);
+
+    /**
+     * @brief Get the proven result of this Node
+     *
+     * @return eProof: eProof::UNKNOWN if not proven yet
+     */
+    eProof getProof() const;
+    /**
+     * @brief Set the proven result of this Node
+     *
+     * @param proof
+     */
+    void setProof(eProof proof);
+
+    /**
+     * @brief Return true if the result of this Node is known
+     *
+     * @return bool
+     */
+    bool isProven() const;
+
+    /**
+     * @brief Get the exact value of a proven Node: 1 for a win, -1 for a loss, 0 for a draw.
+     *
+     * @return float
+     */
+    float getProvenValue() const;
+
+    /**
+     * @brief Store a network evaluation of this Node's position that was computed ahead of time
+     *
+     * @param policy: the policy output for the position
+     * @param value: the value output for the position
+     */
+    void setEvaluation(torch::Tensor const & policy, float value);
+
+    /**
+     * @brief Return true if this Node has an evaluation computed ahead of time
+     *
+     * @return bool
+     */
+    bool hasEvaluation() const;
+
+    /**
+     * @brief Take the evaluation computed ahead of time out of this Node
+     *
+     * @return std::pair<torch::Tensor, float>: the policy and value output
+     */
+    std::pair<torch::Tensor, float> takeEvaluation();
+
+    /**
+     * @brief Estimate the amount of memory this Node uses, excluding its children.
+     *
+     * @return size_t: the size in bytes
+     */
+    size_t getMemoryUsage() const;
 
   private:
-    Node *                             m_Parent      = nullptr;
-    std::vector<std::unique_ptr<Node>> m_Children    = {};
-    std::shared_ptr<Environment>       m_Environment = nullptr;
-    int                                m_Move        = -1;
-    float                              m_Prior       = 0.0f;
-    float                              m_Value       = 0.0f;
-    int                                m_Visits      = 0;
-};
\ No newline at end of file
+    Node *   m_Parent   = nullptr;
+    Children m_Children = {};
+    // with compact nodes or a node storage, a child only gets its environment once it is needed
+    mutable std::shared_ptr<Environment> m_Environment = nullptr;
+    EdgeStats                            m_Stats;
+    // speculative evaluation, only allocated for the few nodes that get one
+    std::unique_ptr<std::pair<torch::Tensor, float>> m_Evaluation = nullptr;
+};
+
+// The 4 bytes the compact statistics save are lost to the alignment of the pointers around them,
+// so a Node is 72 bytes in both modes on 64-bit platforms: compact nodes save their memory by leaving out the environments.
+static_assert(sizeof(void *) != 8 || sizeof(Node) == 72, "Node layout changed: update the memory estimates");
\ No newline at end of file
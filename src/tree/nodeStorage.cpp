@@ -0,0 +1,177 @@
+#include "nodeStorage.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <atomic>
+
+NodeStorage::NodeStorage(std::filesystem::path const & path, size_t maxBytes)
+{
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    m_Fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (m_Fd < 0)
+    {
+        LFATAL << "Could not create node storage file " << path;
+    }
+    // the file is only needed while the program runs
+    unlink(path.c_str());
+
+    // reserve the address range without memory behind it, blocks of the file are mapped into it later
+    m_Reserved  = (maxBytes + blockSize - 1) / blockSize * blockSize;
+    void * base = mmap(nullptr, m_Reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        LFATAL << "Could not reserve " << m_Reserved / (1024 * 1024) << " MiB of address space for the node storage";
+    }
+    m_Base = static_cast<char *>(base);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    m_StartMajorFaults = usage.ru_majflt;
+    m_StartMinorFaults = usage.ru_minflt;
+    LINFO << "Storing nodes in " << path << ", up to " << m_Reserved / (1024 * 1024) << " MiB";
+}
+
+NodeStorage::~NodeStorage()
+{
+    // the active storage is destroyed with the other statics, when the logger may already be gone: don't log here
+    munmap(m_Base, m_Reserved);
+    close(m_Fd);
+}
+
+bool NodeStorage::grow()
+{
+    if (m_Mapped + blockSize > m_Reserved || ftruncate(m_Fd, (off_t)(m_Mapped + blockSize)) != 0)
+    {
+        return false;
+    }
+    void * block = mmap(m_Base + m_Mapped, blockSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_Fd, (off_t)m_Mapped);
+    if (block == MAP_FAILED)
+    {
+        return false;
+    }
+    m_Mapped += blockSize;
+    return true;
+}
+
+void * NodeStorage::allocate(size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // nodes and children lists only come in a few sizes, so a freed slot is soon reused by one of the same size
+    size_t const slot      = (size + alignment - 1) / alignment * alignment;
+    size_t const sizeClass = slot / alignment;
+    m_Used += slot;
+    if (sizeClass < m_Free.size() && !m_Free[sizeClass].empty())
+    {
+        void * pointer = m_Free[sizeClass].back();
+        m_Free[sizeClass].pop_back();
+        return pointer;
+    }
+    if (m_Next + slot > m_Mapped && !grow())
+    {
+        m_Used -= slot;
+        return nullptr;
+    }
+    void * pointer = m_Base + m_Next;
+    m_Next += slot;
+    return pointer;
+}
+
+void NodeStorage::deallocate(void * pointer, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    size_t const                slot      = (size + alignment - 1) / alignment * alignment;
+    size_t const                sizeClass = slot / alignment;
+    if (sizeClass >= m_Free.size())
+    {
+        m_Free.resize(sizeClass + 1);
+    }
+    m_Free[sizeClass].push_back(pointer);
+    m_Used -= slot;
+}
+
+bool NodeStorage::owns(void const * pointer) const
+{
+    char const * address = static_cast<char const *>(pointer);
+    return address >= m_Base && address < m_Base + m_Reserved;
+}
+
+NodeStorage::Statistics NodeStorage::getStatistics() const
+{
+    Statistics stats;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        stats.mappedBytes = m_Mapped;
+        stats.usedBytes   = m_Used;
+    }
+
+    // ask the kernel which pages of the file are in memory
+    size_t const               pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> resident((stats.mappedBytes + pageSize - 1) / pageSize);
+    if (stats.mappedBytes > 0 && mincore(m_Base, stats.mappedBytes, resident.data()) == 0)
+    {
+        for (unsigned char page: resident)
+        {
+            stats.residentBytes += (page & 1) * pageSize;
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    stats.majorFaults = usage.ru_majflt - m_StartMajorFaults;
+    stats.minorFaults = usage.ru_minflt - m_StartMinorFaults;
+    return stats;
+}
+
+void NodeStorage::logStatistics() const
+{
+    Statistics stats    = getStatistics();
+    float      resident = stats.mappedBytes > 0 ? 100.0f * (float)stats.residentBytes / (float)stats.mappedBytes : 0.0f;
+    LINFO << "Node storage: " << stats.usedBytes / 1024 << " KiB used of " << stats.mappedBytes / 1024 << " KiB mapped, " << resident
+          << "% resident, " << stats.majorFaults << " major / " << stats.minorFaults << " minor page faults";
+}
+
+void NodeStorage::setActive(std::shared_ptr<NodeStorage> storage)
+{
+    s_Active = storage;
+}
+
+NodeStorage * NodeStorage::getActive()
+{
+    return s_Active.get();
+}
+
+void * NodeStorage::allocateTree(size_t size)
+{
+    NodeStorage * storage = getActive();
+    if (storage != nullptr)
+    {
+        void * pointer = storage->allocate(size);
+        if (pointer != nullptr)
+        {
+            return pointer;
+        }
+        static std::atomic<bool> warned = false;
+        if (!warned.exchange(true))
+        {
+            LWARN << "Node storage is full, allocating nodes on the heap";
+        }
+    }
+    return ::operator new(size);
+}
+
+void NodeStorage::deallocateTree(void * pointer, size_t size)
+{
+    NodeStorage * storage = getActive();
+    if (storage != nullptr && storage->owns(pointer))
+    {
+        storage->deallocate(pointer, size);
+        return;
+    }
+    ::operator delete(pointer);
+}
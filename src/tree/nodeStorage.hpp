@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../common.hpp"
+
+/**
+ * @brief Storage for the search tree in a memory-mapped file instead of on the heap, so the tree can grow beyond RAM.
+ * The kernel keeps the often visited upper levels of the tree resident, and pages cold nodes out to the file.
+ * The file grows in blocks inside one reserved address range, so nodes never move.
+ * The Node objects and their children lists live in the file. Positions can't: while a storage is active,
+ * only the root keeps its environment, the other nodes replay their moves from it when the search needs them.
+ * logTreeStatistics reports how much of the tree is in the file.
+ *
+ */
+class NodeStorage
+{
+  public:
+    /**
+     * @brief Paging statistics of the storage
+     *
+     */
+    struct Statistics
+    {
+        size_t mappedBytes   = 0; // size of the file
+        size_t usedBytes     = 0; // bytes used by live nodes
+        size_t residentBytes = 0; // bytes of the file that are currently in RAM
+        long   majorFaults   = 0; // page faults that had to read from disk, since the storage was opened
+        long   minorFaults   = 0;
+    };
+
+    /**
+     * @brief Create the storage file. The file is removed from the directory immediately,
+     * so it disappears when the program exits.
+     *
+     * @param path: the file to store the nodes in
+     * @param maxBytes: the largest size the file can grow to
+     */
+    NodeStorage(std::filesystem::path const & path, size_t maxBytes);
+    ~NodeStorage();
+
+    NodeStorage(NodeStorage const &)             = delete;
+    NodeStorage & operator=(NodeStorage const &) = delete;
+
+    /**
+     * @brief Allocate memory for a node or a children list. Freed memory of the same size is reused.
+     *
+     * @param size: the amount of bytes
+     * @return void*: the memory, nullptr if the storage is full
+     */
+    void * allocate(size_t size);
+
+    /**
+     * @brief Return memory to the storage
+     *
+     * @param pointer: memory from allocate()
+     * @param size: the size given to allocate()
+     */
+    void deallocate(void * pointer, size_t size);
+
+    /**
+     * @brief Return true if the given memory belongs to this storage
+     *
+     * @param pointer
+     * @return bool
+     */
+    bool owns(void const * pointer) const;
+
+    /**
+     * @brief Get the size and residency of the storage, and the page faults since it was opened
+     *
+     * @return Statistics
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * @brief Log the statistics of the storage
+     *
+     */
+    void logStatistics() const;
+
+    /**
+     * @brief Allocate all nodes that are created from now on in the given storage.
+     * The storage must stay alive as long as any of its nodes, so it is kept until the program exits.
+     *
+     * @param storage
+     */
+    static void setActive(std::shared_ptr<NodeStorage> storage);
+
+    /**
+     * @brief Get the storage new nodes are allocated in
+     *
+     * @return NodeStorage*: nullptr if nodes are allocated on the heap
+     */
+    static NodeStorage * getActive();
+
+    /**
+     * @brief Allocate memory for the tree: in the active storage, or on the heap if there is none or it is full
+     *
+     * @param size: the amount of bytes
+     * @return void*: the memory
+     */
+    static void * allocateTree(size_t size);
+
+    /**
+     * @brief Free memory from allocateTree()
+     *
+     * @param pointer: the memory
+     * @param size: the size given to allocateTree()
+     */
+    static void deallocateTree(void * pointer, size_t size);
+
+  private:
+    /**
+     * @brief Map another block of the file. Must be called with the mutex locked.
+     *
+     * @return true if successful
+     */
+    bool grow();
+
+    static constexpr size_t blockSize = 64 * 1024 * 1024;
+    static constexpr size_t alignment = 16;
+
+    int                  m_Fd       = -1;
+    char *               m_Base     = nullptr;
+    size_t               m_Reserved = 0; // reserved address range
+    size_t               m_Mapped   = 0; // mapped part of the file
+    size_t               m_Next     = 0; // first never used byte
+    size_t               m_Used     = 0;
+    // freed slots per size, in units of the alignment
+    std::vector<std::vector<void *>> m_Free;
+    mutable std::mutex   m_Mutex;
+    long                 m_StartMajorFaults = 0;
+    long                 m_StartMinorFaults = 0;
+
+    static inline std::shared_ptr<NodeStorage> s_Active = nullptr;
+};
+
+/**
+ * @brief Allocator for the containers of the search tree, e.g. the children of a Node,
+ * so they are kept in the active node storage like the nodes themselves
+ *
+ * @tparam T: the type of the elements
+ */
+template <typename T>
+class StorageAllocator
+{
+  public:
+    using value_type = T;
+
+    StorageAllocator() = default;
+    template <typename U>
+    StorageAllocator(StorageAllocator<U> const &) noexcept
+    {
+    }
+
+    T * allocate(size_t amount)
+    {
+        return static_cast<T *>(NodeStorage::allocateTree(amount * sizeof(T)));
+    }
+    void deallocate(T * pointer, size_t amount)
+    {
+        NodeStorage::deallocateTree(pointer, amount * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(StorageAllocator<U> const &) const noexcept
+    {
+        return true;
+    }
+};
@@ -0,0 +1,139 @@
+#include "openingTree.hpp"
+
+#include "../mcts.hpp"
+
+OpeningTree::OpeningTree(int plies, int rows, int cols)
+  : m_Plies(plies)
+  , m_Rows(rows)
+  , m_Cols(cols)
+  , m_Root(std::make_unique<Node>(std::make_shared<Environment>(rows, cols)))
+{
+}
+
+bool OpeningTree::covers(int ply) const
+{
+    return ply < m_Plies;
+}
+
+int OpeningTree::getMaxPly() const
+{
+    return m_Plies + 1;
+}
+
+std::unique_ptr<Node> OpeningTree::seed(std::shared_ptr<Environment> const & env, std::shared_ptr<NeuralNetwork> const & nn)
+{
+    if (nn->getChecksum() != m_ModelChecksum)
+    {
+        // the statistics of another model are worthless
+        LINFO << "New model: starting a new opening tree";
+        m_ModelChecksum = nn->getChecksum();
+        m_Root          = std::make_unique<Node>(std::make_shared<Environment>(m_Rows, m_Cols));
+    }
+
+    std::vector<int> moves = env->getMoveHistory();
+    Node const *     node  = find(moves);
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+    std::unique_ptr<Node> root = copy(node, nullptr, (int)moves.size());
+    LDEBUG << "Seeded the search with " << node->getVisits() << " visits from the opening tree";
+    return root;
+}
+
+void OpeningTree::update(Node const * searched, std::shared_ptr<NeuralNetwork> const & nn)
+{
+    if (nn->getChecksum() != m_ModelChecksum)
+    {
+        return;
+    }
+    std::shared_ptr<Environment> const & env   = searched->getEnvironment();
+    std::vector<int>                     moves = env->getMoveHistory();
+    Node *                               node  = find(moves);
+    if (node == nullptr)
+    {
+        return;
+    }
+
+    if (node->getChildren().empty() && !searched->getChildren().empty())
+    {
+        // the searched root's children have noise in their priors: expand with the network's own priors first
+        auto [policy, value] = nn->evaluate(env);
+        for (auto const & child: searched->getChildren())
+        {
+            std::shared_ptr<Environment> childEnv = std::make_shared<Environment>(child->getEnvironment());
+            node->addChild(std::make_unique<Node>(node, std::move(childEnv), child->getMove(), policy[child->getMove()].item<float>()));
+        }
+    }
+    merge(node, searched, (int)moves.size());
+}
+
+Node * OpeningTree::find(std::vector<int> const & moves) const
+{
+    Node * node = m_Root.get();
+    for (int move: moves)
+    {
+        node = node->getChildAfterMove(move);
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+    }
+    return node;
+}
+
+std::unique_ptr<Node> OpeningTree::copy(Node const * source, Node * parent, int ply) const
+{
+    // only the root needs its own environment if the other nodes can replay theirs
+    std::shared_ptr<Environment> env  = parent == nullptr || !Node::replaysEnvironments()
+                                            ? std::make_shared<Environment>(source->getEnvironment())
+                                            : nullptr;
+    std::unique_ptr<Node>        node = parent == nullptr ? std::make_unique<Node>(std::move(env))
+                                                          : std::make_unique<Node>(parent, std::move(env), source->getMove(), source->getPrior());
+    node->setValue(source->getValue());
+    node->addVisits(source->getVisits());
+    node->setProof(source->getProof());
+    node->setTerminal(source->isTerminal());
+    if (ply < getMaxPly())
+    {
+        for (auto const & child: source->getChildren())
+        {
+            node->addChild(copy(child.get(), node.get(), ply + 1));
+        }
+    }
+    return node;
+}
+
+void OpeningTree::merge(Node * target, Node const * source, int ply) const
+{
+    // the searched node started as a copy of the target, so its statistics include the target's
+    if (source->getVisits() < target->getVisits())
+    {
+        return;
+    }
+    target->addVisits(source->getVisits() - target->getVisits());
+    target->setValue(source->getValue());
+    target->setProof(source->getProof());
+    target->setTerminal(source->isTerminal());
+    if (ply >= getMaxPly())
+    {
+        return;
+    }
+    for (auto const & child: source->getChildren())
+    {
+        Node * existing = target->getChildAfterMove(child->getMove());
+        if (existing != nullptr)
+        {
+            merge(existing, child.get(), ply + 1);
+        }
+        else
+        {
+            target->addChild(copy(child.get(), target, ply + 1));
+        }
+    }
+}
+
+int OpeningTree::getNodeCount() const
+{
+    return MCTS::countNodes(m_Root.get());
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+
+#include "../neuralNetwork.hpp"
+#include "node.hpp"
+
+/**
+ * @brief A search tree over the first plies of the game, kept across self-play games with the same model.
+ * Every game starts its searches in the opening from a copy of this tree, and writes its search back,
+ * so the visits of all games add up. Noise is added to the game's copy, never to the opening tree.
+ *
+ */
+class OpeningTree
+{
+  public:
+    /**
+     * @brief Construct a new, empty opening tree
+     *
+     * @param plies: the amount of plies from the start of the game that are shared
+     * @param rows: the amount of rows of the board
+     * @param cols: the amount of columns of the board
+     */
+    OpeningTree(int plies, int rows, int cols);
+
+    /**
+     * @brief Return true if the position after the given amount of moves is still part of the opening
+     *
+     * @param ply: the amount of moves played
+     * @return bool
+     */
+    bool covers(int ply) const;
+
+    /**
+     * @brief Create a copy of the opening tree's subtree at the given position, to search from.
+     * All statistics are dropped first if the model is different from the one the tree was built with.
+     *
+     * @param env: the position
+     * @param nn: the network the game searches with
+     * @return std::unique_ptr<Node>: the new root, nullptr if the position is not in the opening tree
+     */
+    std::unique_ptr<Node> seed(std::shared_ptr<Environment> const & env, std::shared_ptr<NeuralNetwork> const & nn);
+
+    /**
+     * @brief Write the statistics of a searched tree, started from seed(), back into the opening tree
+     *
+     * @param searched: the root of the searched tree
+     * @param nn: the network the game searched with, to get the root's priors without noise
+     */
+    void update(Node const * searched, std::shared_ptr<NeuralNetwork> const & nn);
+
+    /**
+     * @brief Get the amount of nodes in the opening tree
+     *
+     * @return int
+     */
+    int getNodeCount() const;
+
+  private:
+    /**
+     * @brief Find the node of the position after the given moves
+     *
+     * @param moves: the moves from the start of the game
+     * @return Node*: the node, nullptr if it doesn't exist
+     */
+    Node * find(std::vector<int> const & moves) const;
+
+    /**
+     * @brief Copy a subtree, up to the given ply
+     *
+     * @param source: the root of the subtree
+     * @param parent: the parent of the copy
+     * @param ply: the ply of the source's position
+     * @return std::unique_ptr<Node>: the copy
+     */
+    std::unique_ptr<Node> copy(Node const * source, Node * parent, int ply) const;
+
+    /**
+     * @brief Merge the statistics of a searched subtree into an opening subtree of the same position.
+     * The opening tree's priors are kept.
+     *
+     * @param target: the node in the opening tree
+     * @param source: the searched node
+     * @param ply: the ply of their position
+     */
+    void merge(Node * target, Node const * source, int ply) const;
+
+    /**
+     * @brief Return the ply up to which nodes are kept: two plies past the last opening position,
+     * so the seed of that position still contains the searched replies.
+     *
+     * @return int
+     */
+    int getMaxPly() const;
+
+    int                   m_Plies         = 0;
+    int                   m_Rows          = 0;
+    int                   m_Cols          = 0;
+    uint64_t              m_ModelChecksum = 0;
+    std::unique_ptr<Node> m_Root          = nullptr;
+};
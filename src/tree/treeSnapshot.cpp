@@ -0,0 +1,248 @@
+#include "treeSnapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "../utils/utils.hpp"
+
+namespace treeSnapshot
+{
+
+bool save(Node const * root, std::filesystem::path const & path)
+{
+    if (root == nullptr)
+    {
+        LWARN << "Can't save an empty tree";
+        return false;
+    }
+
+    // pre-order: push the children in reverse, so the first child is written first
+    std::vector<NodeRecord>   records;
+    std::vector<Node const *> stack = {root};
+    while (!stack.empty())
+    {
+        Node const * node = stack.back();
+        stack.pop_back();
+
+        NodeRecord record;
+        record.prior    = node->getPrior();
+        record.value    = node->getValue();
+        record.visits   = node->getVisits();
+        record.move     = (int8_t)node->getMove();
+        record.children = (uint8_t)node->getChildren().size();
+        record.proof    = (uint8_t)node->getProof();
+        record.terminal = node->isTerminal() ? 1 : 0;
+        records.push_back(record);
+
+        for (auto child = node->getChildren().rbegin(); child != node->getChildren().rend(); child++)
+        {
+            stack.push_back(child->get());
+        }
+    }
+
+    std::shared_ptr<Environment> const & env     = root->getEnvironment();
+    std::vector<int>                     history = env->getMoveHistory();
+    if (history.empty() && env->getBoard().count_nonzero().item<int>() > 0)
+    {
+        LWARN << "Can't save a tree of a position without move history";
+        return false;
+    }
+    std::vector<int8_t>                  moves(history.begin(), history.end());
+    std::vector<uint8_t>                 board = utils::boardToVector(env->getBoard());
+
+    Header header;
+    header.rows        = env->getRows();
+    header.cols        = env->getCols();
+    header.player      = static_cast<uint8_t>(env->getCurrentPlayer());
+    header.historySize = (uint32_t)moves.size();
+    header.nodeCount   = (uint32_t)records.size();
+
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        LWARN << "Could not open " << path << " to save the tree";
+        return false;
+    }
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    file.write(reinterpret_cast<char const *>(moves.data()), moves.size());
+    file.write(reinterpret_cast<char const *>(board.data()), board.size());
+    file.write(reinterpret_cast<char const *>(records.data()), records.size() * sizeof(NodeRecord));
+    file.close();
+
+    LINFO << "Saved tree with " << records.size() << " nodes to " << path;
+    return true;
+}
+
+/**
+ * @brief Copy the statistics of a record into a node
+ *
+ */
+static void applyRecord(Node * node, NodeRecord const & record)
+{
+    node->setValue(record.value);
+    node->addVisits(record.visits);
+    node->setProof(static_cast<eProof>(record.proof));
+    node->setTerminal(record.terminal != 0);
+}
+
+/**
+ * @brief Rebuild the tree from the mapped file. Only the root gets an environment:
+ * the other nodes replay their move on their parent's position once the search reaches them.
+ *
+ * @param header: the file's header
+ * @param cursor: the start of the root's move history, directly after the header
+ * @return std::unique_ptr<Node>: the root of the tree, nullptr if the file is inconsistent
+ */
+static std::unique_ptr<Node> rebuildTree(Header const & header, char const * cursor)
+{
+    // replay the moves, the environment needs its history to detect wins
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(header.rows, header.cols);
+    for (uint32_t i = 0; i < header.historySize; i++)
+    {
+        int8_t move = static_cast<int8_t>(cursor[i]);
+        if (!env->isValidMove(move))
+        {
+            return nullptr;
+        }
+        env->makeMove(move);
+    }
+    cursor += header.historySize;
+
+    // the stored board must be the result of the history. A board without a history,
+    // e.g. a puzzle set up with setBoard, can't be restored: wins near the root would go unnoticed.
+    torch::Tensor board = torch::from_blob(const_cast<char *>(cursor), {header.rows, header.cols}, torch::TensorOptions().dtype(torch::kUInt8));
+    if (!board.to(env->getBoard().scalar_type()).equal(env->getBoard()) || header.player != static_cast<uint8_t>(env->getCurrentPlayer()))
+    {
+        LWARN << "The tree's position doesn't follow from its move history";
+        return nullptr;
+    }
+
+    // the height of every column, to check the moves without building the positions
+    std::vector<int> heights(header.cols, 0);
+    for (int32_t row = 0; row < header.rows; row++)
+    {
+        for (int32_t col = 0; col < header.cols; col++)
+        {
+            heights[col] += cursor[row * header.cols + col] != 0 ? 1 : 0;
+        }
+    }
+    cursor += (size_t)header.rows * (size_t)header.cols;
+
+    // the records directly follow the variable-sized board, so they may be unaligned: copy them out one by one
+    NodeRecord record;
+    std::memcpy(&record, cursor, sizeof(record));
+    std::unique_ptr<Node> root = std::make_unique<Node>(env);
+    applyRecord(root.get(), record);
+
+    // every entry is a node that still expects the given amount of children, with the column heights of its position
+    struct Parent
+    {
+        Node *           node;
+        int              children;
+        std::vector<int> heights;
+    };
+    std::vector<Parent> parents;
+    if (record.children > 0)
+    {
+        parents.push_back({root.get(), record.children, heights});
+    }
+    for (uint32_t i = 1; i < header.nodeCount; i++)
+    {
+        std::memcpy(&record, cursor + i * sizeof(NodeRecord), sizeof(record));
+        if (parents.empty() || record.move < 0 || record.move >= header.cols || parents.back().heights[record.move] >= header.rows)
+        {
+            return nullptr;
+        }
+        Node *           parent       = parents.back().node;
+        std::vector<int> childHeights = parents.back().heights;
+        childHeights[record.move]++;
+        if (--parents.back().children == 0)
+        {
+            parents.pop_back();
+        }
+
+        std::unique_ptr<Node> child = std::make_unique<Node>(parent, nullptr, record.move, record.prior);
+        applyRecord(child.get(), record);
+        Node * rawChild = child.get();
+        parent->addChild(std::move(child));
+
+        if (record.children > 0)
+        {
+            parents.push_back({rawChild, record.children, std::move(childHeights)});
+        }
+    }
+    if (!parents.empty())
+    {
+        return nullptr;
+    }
+    return root;
+}
+
+std::unique_ptr<Node> load(std::filesystem::path const & path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LWARN << "Could not open tree file " << path;
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < (off_t)sizeof(Header))
+    {
+        LWARN << "Tree file " << path << " is too small";
+        close(fd);
+        return nullptr;
+    }
+    size_t const size = status.st_size;
+    void *       data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LWARN << "Could not map tree file " << path;
+        return nullptr;
+    }
+
+    std::unique_ptr<Node> root   = nullptr;
+    char const *          cursor = static_cast<char const *>(data);
+    Header                header;
+    std::memcpy(&header, cursor, sizeof(header));
+    cursor += sizeof(header);
+
+    size_t const boardSize = (size_t)header.rows * (size_t)header.cols;
+    size_t const expected  = sizeof(Header) + header.historySize + boardSize + (size_t)header.nodeCount * sizeof(NodeRecord);
+    if (std::memcmp(header.magic, Header().magic, sizeof(header.magic)) != 0 || header.version != Header().version)
+    {
+        LWARN << path << " is not a tree file, or has an unsupported version";
+    }
+    else if (size != expected || header.nodeCount == 0)
+    {
+        LWARN << "Tree file " << path << " has " << size << " bytes, expected " << expected;
+    }
+    else
+    {
+        root = rebuildTree(header, cursor);
+        if (root == nullptr)
+        {
+            LWARN << "Tree file " << path << " is corrupt";
+        }
+    }
+
+    munmap(data, size);
+    if (root != nullptr)
+    {
+        LINFO << "Loaded tree with " << header.nodeCount << " nodes from " << path;
+    }
+    return root;
+}
+
+} // namespace treeSnapshot
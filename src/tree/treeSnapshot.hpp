@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "node.hpp"
+
+namespace treeSnapshot
+{
+
+/**
+ * @brief The start of a tree snapshot file.
+ * It is followed by the root's move history, the root's board, and the node records.
+ *
+ */
+struct Header
+{
+    char     magic[4]    = {'C', '4', 'T', 'R'};
+    uint32_t version     = 1;
+    int32_t  rows        = 0;
+    int32_t  cols        = 0;
+    uint8_t  player      = 0;
+    uint8_t  padding[3]  = {0, 0, 0};
+    uint32_t historySize = 0;
+    uint32_t nodeCount   = 0;
+};
+
+/**
+ * @brief A single node in a tree snapshot. Nodes are stored in pre-order,
+ * so every node is followed by its children's subtrees.
+ *
+ */
+struct NodeRecord
+{
+    float   prior;
+    float   value;
+    int32_t visits;
+    int8_t  move;
+    uint8_t children;
+    uint8_t proof;
+    uint8_t terminal;
+};
+static_assert(sizeof(NodeRecord) == 16, "NodeRecord must stay 16 bytes");
+
+/**
+ * @brief Write the tree under the given root to a binary file.
+ * The root's position needs its move history, a board set up without one can't be saved.
+ *
+ * @param root: the root of the tree
+ * @param path: the file to write to
+ * @return true if successful
+ */
+bool save(Node const * root, std::filesystem::path const & path);
+
+/**
+ * @brief Rebuild a tree from a binary file. The file is mapped into memory
+ * and the nodes are rebuilt in a single pass. Only the root's position is built,
+ * the other nodes create theirs when the search reaches them.
+ *
+ * @param path: the file to read
+ * @return std::unique_ptr<Node>: the root of the tree, nullptr on error
+ */
+std::unique_ptr<Node> load(std::filesystem::path const & path);
+
+} // namespace treeSnapshot
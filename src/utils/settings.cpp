@@ -20,6 +20,216 @@ void Settings::setSimulations(int simulations)
     m_Simulations = simulations;
 }
 
+int Settings::getSearchTime() const
+{
+    return m_SearchTime;
+}
+
+void Settings::setSearchTime(int milliseconds)
+{
+    m_SearchTime = milliseconds;
+}
+
+int Settings::getSearchNodes() const
+{
+    return m_SearchNodes;
+}
+
+void Settings::setSearchNodes(int nodes)
+{
+    m_SearchNodes = nodes;
+}
+
+bool Settings::useEarlyStop() const
+{
+    return m_EarlyStop;
+}
+
+void Settings::setEarlyStop(bool earlyStop)
+{
+    m_EarlyStop = earlyStop;
+}
+
+bool Settings::useAdaptiveSimulations() const
+{
+    return m_AdaptiveSims;
+}
+
+void Settings::setAdaptiveSimulations(bool adaptive)
+{
+    m_AdaptiveSims = adaptive;
+}
+
+int Settings::getConvergenceInterval() const
+{
+    return m_ConvergenceInterval;
+}
+
+void Settings::setConvergenceInterval(int interval)
+{
+    m_ConvergenceInterval = interval;
+}
+
+float Settings::getConvergenceThreshold() const
+{
+    return m_ConvergenceThresh;
+}
+
+void Settings::setConvergenceThreshold(float threshold)
+{
+    m_ConvergenceThresh = threshold;
+}
+
+int Settings::getFastSimulations() const
+{
+    return m_FastSimulations;
+}
+
+void Settings::setFastSimulations(int simulations)
+{
+    m_FastSimulations = simulations;
+}
+
+float Settings::getFullSearchProbability() const
+{
+    return m_FullSearchProb;
+}
+
+void Settings::setFullSearchProbability(float probability)
+{
+    m_FullSearchProb = probability;
+}
+
+bool Settings::useDirichletNoise() const
+{
+    return m_DirichletNoise;
+}
+
+void Settings::setDirichletNoise(bool dirichletNoise)
+{
+    m_DirichletNoise = dirichletNoise;
+}
+
+int Settings::getRootParallelSearches() const
+{
+    return m_RootParallel;
+}
+
+void Settings::setRootParallelSearches(int searches)
+{
+    m_RootParallel = searches;
+}
+
+bool Settings::usePondering() const
+{
+    return m_Ponder;
+}
+
+void Settings::setPondering(bool ponder)
+{
+    m_Ponder = ponder;
+}
+
+bool Settings::useSharedTree() const
+{
+    return m_SharedTree;
+}
+
+void Settings::setSharedTree(bool sharedTree)
+{
+    m_SharedTree = sharedTree;
+}
+
+int Settings::getOpeningTreePlies() const
+{
+    return m_OpeningTreePlies;
+}
+
+void Settings::setOpeningTreePlies(int plies)
+{
+    m_OpeningTreePlies = plies;
+}
+
+bool Settings::usePruning() const
+{
+    return m_Prune;
+}
+
+void Settings::setPruning(bool prune)
+{
+    m_Prune = prune;
+}
+
+bool Settings::useGumbel() const
+{
+    return m_Gumbel;
+}
+
+void Settings::setGumbel(bool gumbel)
+{
+    m_Gumbel = gumbel;
+}
+
+int Settings::getGumbelActions() const
+{
+    return m_GumbelActions;
+}
+
+void Settings::setGumbelActions(int actions)
+{
+    m_GumbelActions = actions;
+}
+
+int Settings::getSearchBatchSize() const
+{
+    return m_SearchBatchSize;
+}
+
+void Settings::setSearchBatchSize(int batchSize)
+{
+    m_SearchBatchSize = batchSize;
+}
+
+int Settings::getBatchTimeout() const
+{
+    return m_BatchTimeout;
+}
+
+void Settings::setBatchTimeout(int microseconds)
+{
+    m_BatchTimeout = microseconds;
+}
+
+int Settings::getInferenceBatchSize() const
+{
+    return m_InferenceBatchSize;
+}
+
+void Settings::setInferenceBatchSize(int batchSize)
+{
+    m_InferenceBatchSize = batchSize;
+}
+
+int Settings::getInferenceWait() const
+{
+    return m_InferenceWait;
+}
+
+void Settings::setInferenceWait(int microseconds)
+{
+    m_InferenceWait = microseconds;
+}
+
+int Settings::getSpeculativeChildren() const
+{
+    return m_SpeculativeChildren;
+}
+
+void Settings::setSpeculativeChildren(int children)
+{
+    m_SpeculativeChildren = children;
+}
+
 bool Settings::isStochastic() const
 {
     return m_UseStochasticSearch;
@@ -40,6 +250,16 @@ void Settings::setShowMoves(bool show_moves)
     m_ShowMoves = show_moves;
 }
 
+bool Settings::logTreeStatistics() const
+{
+    return m_LogTreeStatistics;
+}
+
+void Settings::setLogTreeStatistics(bool log_tree_statistics)
+{
+    m_LogTreeStatistics = log_tree_statistics;
+}
+
 bool Settings::saveMemory() const
 {
     return m_SaveMemory;
@@ -145,6 +365,166 @@ int Settings::getOutputSize() const
     return m_Cols;
 }
 
+int Settings::getResidualBlocks() const
+{
+    return m_ResidualBlocks;
+}
+
+void Settings::setResidualBlocks(int blocks)
+{
+    m_ResidualBlocks = blocks;
+}
+
+int Settings::getFilters() const
+{
+    return m_Filters;
+}
+
+void Settings::setFilters(int filters)
+{
+    m_Filters = filters;
+}
+
+int Settings::getPolicyFilters() const
+{
+    return m_PolicyFilters;
+}
+
+void Settings::setPolicyFilters(int filters)
+{
+    m_PolicyFilters = filters;
+}
+
+int Settings::getValueFilters() const
+{
+    return m_ValueFilters;
+}
+
+void Settings::setValueFilters(int filters)
+{
+    m_ValueFilters = filters;
+}
+
+eBlockType Settings::getBlockType() const
+{
+    return m_BlockType;
+}
+
+void Settings::setBlockType(eBlockType type)
+{
+    m_BlockType = type;
+}
+
+std::filesystem::path const & Settings::getEvaluationStorePath() const
+{
+    return m_EvaluationStorePath;
+}
+
+void Settings::setEvaluationStorePath(std::filesystem::path const & path)
+{
+    m_EvaluationStorePath = path;
+}
+
+int Settings::getEvaluationStoreSize() const
+{
+    return m_EvaluationStoreSize;
+}
+
+void Settings::setEvaluationStoreSize(int entries)
+{
+    m_EvaluationStoreSize = entries;
+}
+
+std::filesystem::path const & Settings::getNodeStoragePath() const
+{
+    return m_NodeStoragePath;
+}
+
+void Settings::setNodeStoragePath(std::filesystem::path const & path)
+{
+    m_NodeStoragePath = path;
+}
+
+int Settings::getNodeStorageSize() const
+{
+    return m_NodeStorageSize;
+}
+
+void Settings::setNodeStorageSize(int gigabytes)
+{
+    m_NodeStorageSize = gigabytes;
+}
+
+std::filesystem::path const & Settings::getScriptedModelPath() const
+{
+    return m_ScriptedModelPath;
+}
+
+void Settings::setScriptedModelPath(std::filesystem::path const & path)
+{
+    m_ScriptedModelPath = path;
+}
+
+bool Settings::useQuantizedInference() const
+{
+    return m_QuantizedInference;
+}
+
+void Settings::setQuantizedInference(bool quantized)
+{
+    m_QuantizedInference = quantized;
+}
+
+int Settings::getCalibrationSize() const
+{
+    return m_CalibrationSize;
+}
+
+void Settings::setCalibrationSize(int positions)
+{
+    m_CalibrationSize = positions;
+}
+
+std::filesystem::path const & Settings::getSmallModelPath() const
+{
+    return m_SmallModelPath;
+}
+
+void Settings::setSmallModelPath(std::filesystem::path const & path)
+{
+    m_SmallModelPath = path;
+}
+
+int Settings::getSmallModelFilters() const
+{
+    return m_SmallModelFilters;
+}
+
+void Settings::setSmallModelFilters(int filters)
+{
+    m_SmallModelFilters = filters;
+}
+
+int Settings::getSmallModelDepth() const
+{
+    return m_SmallModelDepth;
+}
+
+void Settings::setSmallModelDepth(int depth)
+{
+    m_SmallModelDepth = depth;
+}
+
+int Settings::getSmallModelVisits() const
+{
+    return m_SmallModelVisits;
+}
+
+void Settings::setSmallModelVisits(int visits)
+{
+    m_SmallModelVisits = visits;
+}
+
 std::filesystem::path Settings::getModelPath() const
 {
     return m_ModelPath;
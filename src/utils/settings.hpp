@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../connect4/player.hpp"
+#include "../neuralNetwork/blockType.hpp"
 #include "types.hpp"
 
 class Settings
@@ -23,12 +24,78 @@ class Settings
     int  getSimulations() const;
     void setSimulations(int simulations);
 
+    int  getSearchTime() const;
+    void setSearchTime(int milliseconds);
+
+    int  getSearchNodes() const;
+    void setSearchNodes(int nodes);
+
+    bool useEarlyStop() const;
+    void setEarlyStop(bool earlyStop);
+
+    bool useAdaptiveSimulations() const;
+    void setAdaptiveSimulations(bool adaptive);
+
+    int  getConvergenceInterval() const;
+    void setConvergenceInterval(int interval);
+
+    float getConvergenceThreshold() const;
+    void  setConvergenceThreshold(float threshold);
+
+    int  getFastSimulations() const;
+    void setFastSimulations(int simulations);
+
+    float getFullSearchProbability() const;
+    void  setFullSearchProbability(float probability);
+
+    bool useDirichletNoise() const;
+    void setDirichletNoise(bool dirichletNoise);
+
+    int  getRootParallelSearches() const;
+    void setRootParallelSearches(int searches);
+
+    bool usePondering() const;
+    void setPondering(bool ponder);
+
+    bool useSharedTree() const;
+    void setSharedTree(bool sharedTree);
+
+    int  getOpeningTreePlies() const;
+    void setOpeningTreePlies(int plies);
+
+    bool usePruning() const;
+    void setPruning(bool prune);
+
+    bool useGumbel() const;
+    void setGumbel(bool gumbel);
+
+    int  getGumbelActions() const;
+    void setGumbelActions(int actions);
+
+    int  getSearchBatchSize() const;
+    void setSearchBatchSize(int batchSize);
+
+    int  getBatchTimeout() const;
+    void setBatchTimeout(int microseconds);
+
+    int  getInferenceBatchSize() const;
+    void setInferenceBatchSize(int batchSize);
+
+    int  getInferenceWait() const;
+    void setInferenceWait(int microseconds);
+
+    int  getSpeculativeChildren() const;
+    void setSpeculativeChildren(int children);
+
     bool isStochastic() const;
     void setStochastic(bool stochastic);
 
     bool showMoves() const;
     void setShowMoves(bool show_moves);
 
+    bool logTreeStatistics() const;
+    void setLogTreeStatistics(bool log_tree_statistics);
+
     bool saveMemory() const;
     void setSaveMemory(bool save_memory);
 
@@ -61,18 +128,99 @@ class Settings
 
     int getOutputSize() const;
 
+    int  getResidualBlocks() const;
+    void setResidualBlocks(int blocks);
+
+    int  getFilters() const;
+    void setFilters(int filters);
+
+    int  getPolicyFilters() const;
+    void setPolicyFilters(int filters);
+
+    int  getValueFilters() const;
+    void setValueFilters(int filters);
+
+    eBlockType getBlockType() const;
+    void       setBlockType(eBlockType type);
+
+    std::filesystem::path const & getEvaluationStorePath() const;
+    void                          setEvaluationStorePath(std::filesystem::path const & path);
+
+    int  getEvaluationStoreSize() const;
+    void setEvaluationStoreSize(int entries);
+
+    std::filesystem::path const & getNodeStoragePath() const;
+    void                          setNodeStoragePath(std::filesystem::path const & path);
+
+    int  getNodeStorageSize() const;
+    void setNodeStorageSize(int gigabytes);
+
+    std::filesystem::path const & getSmallModelPath() const;
+    void                          setSmallModelPath(std::filesystem::path const & path);
+
+    int  getSmallModelFilters() const;
+    void setSmallModelFilters(int filters);
+
+    int  getSmallModelDepth() const;
+    void setSmallModelDepth(int depth);
+
+    int  getSmallModelVisits() const;
+    void setSmallModelVisits(int visits);
+
+    std::filesystem::path const & getScriptedModelPath() const;
+    void                          setScriptedModelPath(std::filesystem::path const & path);
+
+    bool useQuantizedInference() const;
+    void setQuantizedInference(bool quantized);
+
+    int  getCalibrationSize() const;
+    void setCalibrationSize(int positions);
+
     std::filesystem::path getModelPath() const;
     void                  setModelPath(std::filesystem::path const & model_path);
 
   private:
     int                   m_Simulations         = 200;
+    int                   m_SearchTime          = 0; // milliseconds per move, 0 = no limit
+    int                   m_SearchNodes         = 0; // nodes in the tree, 0 = no limit
+    bool                  m_EarlyStop           = false;
+    bool                  m_DirichletNoise      = true;
+    int                   m_RootParallel        = 1; // independent searches per move
+    bool                  m_Ponder              = false;
+    bool                  m_SharedTree          = true;  // one tree for both sides when they use the same network
+    int                   m_OpeningTreePlies    = 0;     // plies searched in a tree shared across games, 0 = disabled
+    bool                  m_Prune               = false; // prune the tree instead of stopping at the node budget
+    bool                  m_Gumbel              = false;
+    int                   m_GumbelActions       = 16; // moves sampled at the root by the gumbel search
+    int                   m_SearchBatchSize     = 0;  // leaves evaluated per batch during search, 0 = no batching
+    int                   m_BatchTimeout        = 1000; // microseconds a leaf waits for its batch to fill
+    int                   m_SpeculativeChildren = 0;  // children of new nodes evaluated in spare batch slots
+    int                   m_InferenceBatchSize  = 0;  // batch size of the inference server thread, 0 = no server
+    int                   m_InferenceWait       = 500; // microseconds a request waits for the server's batch to fill
+    bool                  m_AdaptiveSims        = false; // stop when the root visits converge, keep the rest for later moves
+    int                   m_ConvergenceInterval = 50;    // simulations between two convergence checks
+    float                 m_ConvergenceThresh   = 1e-3f; // KL divergence below which the root visits have converged
+    int                   m_FastSimulations     = 0; // playout cap randomization, 0 = disabled
+    float                 m_FullSearchProb      = 0.25f;
     bool                  m_UseStochasticSearch = true;
     bool                  m_ShowMoves           = false;
+    bool                  m_LogTreeStatistics   = false;
     bool                  m_SaveMemory          = true;
     int                   m_PipelineGames       = 50;
     bool                  m_useCUDA             = true;
     std::filesystem::path m_MemoryFolder        = "memory";
     std::filesystem::path m_ModelPath           = "models/model.pt";
+    std::filesystem::path m_EvaluationStorePath = ""; // persistent evaluation cache, empty = disabled
+    int                   m_EvaluationStoreSize = 1 << 20; // evaluations in the persistent cache
+    std::filesystem::path m_NodeStoragePath     = ""; // file to keep the search tree's nodes in, empty = on the heap
+    std::filesystem::path m_SmallModelPath      = ""; // small network for unimportant leaves, empty = disabled
+    int                   m_SmallModelFilters   = 32;
+    int                   m_SmallModelDepth     = 0; // leaves deeper than this use the small network, 0 = never
+    int                   m_SmallModelVisits    = 0; // leaves whose parent has fewer visits use the small network, 0 = never
+    int                   m_NodeStorageSize     = 64; // GiB the node storage file can grow to
+    std::filesystem::path m_ScriptedModelPath   = ""; // frozen TorchScript model to run instead of the eager network, empty = eager
+    bool                  m_QuantizedInference  = false; // int8 residual trunk for self-play on the CPU
+    int                   m_CalibrationSize     = 256;   // positions of earlier games that set the int8 activation ranges
 
     float m_LearningRate = 0.02f;
     int   m_BatchSize    = 64;
@@ -81,4 +229,12 @@ class Settings
     int m_Rows        = 6;
     int m_Cols        = 7;
     int m_InputPlanes = 3;
+
+    // architecture of new networks, saved models keep their own
+    int m_ResidualBlocks = 19;
+    int m_Filters        = 256;
+    int m_PolicyFilters  = 2;
+    int m_ValueFilters   = 1;
+
+    eBlockType m_BlockType = eBlockType::RESIDUAL;
 };
\ No newline at end of file
@@ -106,6 +106,456 @@ void testEasyPuzzle()
     assert(game.playGame() == ePlayer::YELLOW);
 }
 
+void testSolver()
+{
+    LINFO << "Testing proven wins in the search tree";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+
+    // yellow to move, and wins by playing in column 0 or 4
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    for (int move: {1, 1, 2, 2, 3, 3})
+    {
+        env->makeMove(move);
+    }
+
+    MCTS mcts = MCTS(settings, std::make_unique<Node>(env), nn);
+    mcts.run_simulations(50);
+
+    [[maybe_unused]] int bestMove = mcts.getBestMoveDeterministic();
+    assert(bestMove == 0 || bestMove == 4);
+    assert(mcts.getRoot()->getChildAfterMove(bestMove)->getProof() == eProof::WIN);
+    assert(mcts.getRoot()->getChildAfterMove(bestMove)->isTerminal());
+}
+
+void testAvoidProvenLoss()
+{
+    LINFO << "Testing avoiding proven losses when picking the most visited move";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+
+    MCTS mcts = MCTS(settings, nullptr, nn);
+    mcts.run_simulations(1);
+    Node::Children const & children = mcts.getRoot()->getChildren();
+    assert(children.size() == 7);
+    // the most visited move turned out to lose
+    children[0]->addVisits(100);
+    children[0]->setProof(eProof::LOSS);
+    children[1]->addVisits(10);
+    assert(mcts.getBestMoveDeterministic() == children[1]->getMove());
+
+    // if every move loses, the most visited one is still played
+    for (auto const & child: children)
+    {
+        child->setProof(eProof::LOSS);
+    }
+    assert(mcts.getBestMoveDeterministic() == children[0]->getMove());
+}
+
+void testTreeSnapshot()
+{
+    LINFO << "Testing saving and loading a search tree";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+
+    std::shared_ptr<Environment> env = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    env->makeMove(3);
+    MCTS mcts = MCTS(settings, std::make_unique<Node>(env), nn);
+    mcts.run_simulations(50);
+    assert(mcts.saveTree("test/tree.bin"));
+
+    MCTS loaded = MCTS(settings, nullptr, nn);
+    assert(loaded.loadTree("test/tree.bin"));
+
+    [[maybe_unused]] TreeStatistics saved    = mcts.getTreeStatistics();
+    [[maybe_unused]] TreeStatistics restored = loaded.getTreeStatistics();
+    assert(saved.nodes == restored.nodes);
+    assert(saved.depthHistogram == restored.depthHistogram);
+    assert(mcts.getRoot()->getVisits() == loaded.getRoot()->getVisits());
+    assert(mcts.getBestMoveDeterministic() == loaded.getBestMoveDeterministic());
+    assert(loaded.getRoot()->getEnvironment()->getMoveHistory() == std::vector<int>{3});
+    // the other positions are only built once the search reaches them
+    loaded.run_simulations(10);
+    assert(loaded.getRoot()->getVisits() > mcts.getRoot()->getVisits());
+
+    // without the move history, wins near the root couldn't be detected after loading
+    std::shared_ptr<Environment> puzzle = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    puzzle->setBoard(env->getBoard());
+    MCTS withoutHistory = MCTS(settings, std::make_unique<Node>(puzzle), nn);
+    assert(!withoutHistory.saveTree("test/puzzle.bin"));
+}
+
+void testReuseUnvisitedChild()
+{
+    LINFO << "Testing reusing an unvisited node as the root";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+
+    MCTS mcts = MCTS(settings, nullptr, nn);
+    mcts.run_simulations(2);
+    // with compact nodes, an unvisited grandchild has no environment of its own yet
+    Node * grandchild = nullptr;
+    for (auto const & child: mcts.getRoot()->getChildren())
+    {
+        if (!child->getChildren().empty())
+        {
+            grandchild = child->getChildren().front().get();
+            break;
+        }
+    }
+    assert(grandchild != nullptr && grandchild->getVisits() == 0);
+    std::vector<int> const history = {grandchild->getParent()->getMove(), grandchild->getMove()};
+
+    mcts.setRoot(grandchild);
+    assert(mcts.getRoot()->getParent() == nullptr);
+    assert(mcts.getRoot()->getEnvironment() != nullptr);
+    assert(mcts.getRoot()->getEnvironment()->getMoveHistory() == history);
+    mcts.run_simulations(10);
+    assert(mcts.getRoot()->getVisits() > 0);
+}
+
+void testAdaptiveSimulationsOnReusedRoot()
+{
+    LINFO << "Testing that a reused root doesn't look converged";
+    std::shared_ptr<Settings> settings = std::make_shared<Settings>();
+    settings->setDirichletNoise(false);
+    settings->setConvergenceInterval(20);
+    std::shared_ptr<NeuralNetwork> nn   = std::make_shared<NeuralNetwork>(settings);
+    MCTS                           mcts = MCTS(settings, nullptr, nn);
+    mcts.run_simulations(1000);
+
+    // the 1000 earlier visits barely move, but only the new visits count: the first check has nothing to compare with,
+    // so the search can't have converged before the check after that
+    settings->setAdaptiveSimulations(true);
+    mcts.run_simulations(1000);
+    assert(mcts.getSimulationsUsed() > convergenceChecks * settings->getConvergenceInterval());
+}
+
+void testBatchedSearchVisits()
+{
+    LINFO << "Testing that every batched simulation adds a visit";
+    std::shared_ptr<Settings> settings = std::make_shared<Settings>();
+    settings->setDirichletNoise(false);
+    settings->setSearchBatchSize(8);
+    std::shared_ptr<NeuralNetwork> nn          = std::make_shared<NeuralNetwork>(settings);
+    MCTS                           mcts        = MCTS(settings, nullptr, nn);
+    int const                      simulations = 200;
+    mcts.run_batched(simulations);
+
+    // leaves selected twice in a batch are not counted: only the first simulation, which expands the root, adds no child visit
+    int childVisits = 0;
+    for (auto const & child: mcts.getRoot()->getChildren())
+    {
+        childVisits += child->getVisits();
+    }
+    assert(childVisits >= simulations - 1 && childVisits <= simulations);
+}
+
+void testOpeningTree()
+{
+    LINFO << "Testing sharing the search of the opening across games";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+    std::shared_ptr<Environment>   env      = std::make_shared<Environment>(settings->getRows(), settings->getCols());
+    [[maybe_unused]] auto [policy, value]   = nn->evaluate(env);
+    OpeningTree openingTree(2, settings->getRows(), settings->getCols());
+
+    int  previousVisits = 0;
+    bool noisy          = false;
+    for (int game = 0; game < 2; game++)
+    {
+        std::unique_ptr<Node> seeded = openingTree.seed(env, nn);
+        assert(seeded != nullptr && seeded->getVisits() == previousVisits);
+        MCTS mcts = MCTS(settings, std::move(seeded), nn);
+        mcts.run_simulations(50);
+        // every game searches on from the visits of the earlier games
+        assert(mcts.getRoot()->getVisits() >= previousVisits + 50);
+        previousVisits = mcts.getRoot()->getVisits();
+        for (auto const & child: mcts.getRoot()->getChildren())
+        {
+            noisy |= std::abs(child->getPrior() - policy[child->getMove()].item<float>()) > 1e-6f;
+        }
+        openingTree.update(mcts.getRoot().get(), nn);
+    }
+    // the games searched with noise on the root's priors
+    assert(noisy);
+
+    std::unique_ptr<Node> merged = openingTree.seed(env, nn);
+    assert(merged->getVisits() == previousVisits);
+    int childVisits = 0;
+    for (auto const & child: merged->getChildren())
+    {
+        childVisits += child->getVisits();
+        // the opening tree keeps the network's priors, the noise stays in the games' copies
+        assert(std::abs(child->getPrior() - policy[child->getMove()].item<float>()) < 1e-6f);
+    }
+    // more than a single game of 50 simulations could have added
+    assert(childVisits > 50);
+}
+
+void testSearchCache()
+{
+    LINFO << "Testing finding cached moves through transpositions";
+    std::shared_ptr<Environment> first  = std::make_shared<Environment>();
+    std::shared_ptr<Environment> second = std::make_shared<Environment>();
+    // the same position, after another opening
+    for (int move: {0, 1, 2, 3})
+    {
+        first->makeMove(move);
+    }
+    for (int move: {2, 3, 0, 1})
+    {
+        second->makeMove(move);
+    }
+
+    SearchCache cache;
+    int         move = -1;
+    assert(!cache.lookup("OldAgent", first, move));
+    cache.store("OldAgent", first, 4);
+    assert(cache.lookup("OldAgent", second, move) && move == 4);
+    assert(cache.getHits() == 1);
+    // another agent would search the position itself
+    assert(!cache.lookup("NewAgent", second, move));
+}
+
+void testEvaluationStore()
+{
+    LINFO << "Testing storing evaluations in a file";
+    std::filesystem::path const path = "test/evaluations.bin";
+    std::filesystem::remove(path);
+    uint64_t const model    = 1234;
+    int const      capacity = 10;
+    torch::Tensor  policy   = torch::arange(7, torch::kFloat32);
+
+    {
+        EvaluationStore store(path, capacity);
+        assert(!store.lookup(model, 1));
+        store.insert(model, 1, policy, 0.5f);
+        std::optional<std::pair<torch::Tensor, float>> stored = store.lookup(model, 1);
+        assert(stored && stored->first.equal(policy) && std::abs(stored->second - 0.5f) < 1e-6f);
+    }
+
+    {
+        // a restarted run finds the evaluations of the previous one
+        EvaluationStore store(path, capacity);
+        assert(store.lookup(model, 1));
+
+        // no entries are added above the load factor, the file keeps its size
+        for (uint64_t key = 2; key <= 3 * capacity; key++)
+        {
+            store.insert(model, key, policy, 0.0f);
+        }
+        int stored = 0;
+        for (uint64_t key = 1; key <= 3 * capacity; key++)
+        {
+            stored += store.lookup(model, key).has_value();
+        }
+        assert(stored == (int)(0.9f * capacity));
+        assert(std::filesystem::file_size(path) == sizeof(EvaluationStore::Header) + capacity * sizeof(EvaluationStore::Entry));
+
+        // another model drops all evaluations
+        assert(!store.lookup(model + 1, 1));
+        assert(!store.lookup(model, 1));
+    }
+}
+
+void testEdgeStats()
+{
+    LINFO << "Testing the node statistics record";
+    EdgeStats stats;
+    assert(stats.getMove() == -1);
+    assert(stats.getProof() == eProof::UNKNOWN);
+
+    stats.setMove(6);
+    stats.setProof(eProof::LOSS);
+    stats.setTerminal(true);
+    stats.setPrior(0.3f);
+    assert(stats.getMove() == 6);
+    assert(stats.getProof() == eProof::LOSS);
+    assert(stats.isTerminal());
+    // half precision keeps about 3 significant digits
+    assert(std::abs(stats.getPrior() - 0.3f) < 1e-3f);
+
+    stats.setTerminal(false);
+    assert(stats.getMove() == 6 && stats.getProof() == eProof::LOSS && !stats.isTerminal());
+}
+
+void testNodeMemory()
+{
+    LINFO << "Testing the memory per node";
+    std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+    std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+    MCTS                           mcts     = MCTS(settings, nullptr, nn);
+    mcts.run_simulations(200);
+
+    TreeStatistics stats            = mcts.getTreeStatistics();
+    size_t const   bytesPerNode     = stats.bytesUsed / stats.nodes;
+    size_t const   environmentBytes = mcts.getRoot()->getEnvironment()->getMemoryUsage();
+    LINFO << "Node: " << sizeof(Node) << " bytes, environment: " << environmentBytes << " bytes, tree: " << bytesPerNode
+          << " bytes per node";
+#ifdef C4_COMPACT_NODES
+    // only the expanded nodes, about one in seven, have an environment
+    assert(bytesPerNode < sizeof(Node) + environmentBytes / 2);
+#else
+    assert(bytesPerNode >= sizeof(Node) + environmentBytes);
+#endif
+}
+
+void testNodeStorage()
+{
+    LINFO << "Testing keeping the search tree in a file";
+    std::shared_ptr<NodeStorage> storage = std::make_shared<NodeStorage>("test/nodes.bin", 256 * 1024 * 1024);
+    int                          onHeap  = 0;
+    void *                       node    = storage->allocate(sizeof(Node));
+    void *                       other   = storage->allocate(sizeof(Node));
+    assert(node != nullptr && other != nullptr && node != other);
+    assert(storage->owns(node) && storage->owns(other) && !storage->owns(&onHeap));
+
+    // a freed slot is only reused for memory of the same size
+    storage->deallocate(node, sizeof(Node));
+    void * children = storage->allocate(7 * sizeof(std::unique_ptr<Node>));
+    assert(children != node && storage->owns(children));
+    assert(storage->allocate(sizeof(Node)) == node);
+
+    // out of core, the nodes and children lists are in the file, and only the root keeps its position
+    NodeStorage::setActive(storage);
+    {
+        std::shared_ptr<Settings>      settings = std::make_shared<Settings>();
+        std::shared_ptr<NeuralNetwork> nn       = std::make_shared<NeuralNetwork>(settings);
+        MCTS                           mcts     = MCTS(settings, nullptr, nn);
+        mcts.run_simulations(100);
+
+        Node const * root = mcts.getRoot().get();
+        assert(storage->owns(root) && storage->owns(root->getChildren().data()));
+        assert(root->hasEnvironment());
+        Node const * expanded = nullptr;
+        for (auto const & child: root->getChildren())
+        {
+            if (!child->getChildren().empty())
+            {
+                assert(!child->hasEnvironment());
+                expanded = child.get();
+            }
+        }
+        assert(expanded != nullptr);
+
+        // the positions are replayed from the root's
+        Node const * grandchild = expanded->getChildren().front().get();
+        assert((grandchild->getEnvironment()->getMoveHistory() == std::vector<int>{expanded->getMove(), grandchild->getMove()}));
+        assert(!expanded->hasEnvironment());
+        TreeStatistics stats = mcts.getTreeStatistics();
+        assert(stats.storedBytes > stats.bytesUsed / 2);
+    }
+    NodeStorage::setActive(nullptr);
+}
+
+void testConvBatchNormFusion()
+{
+    LINFO << "Testing folding the batch norms into the convolutions";
+    torch::NoGradGuard noGrad;
+    for (eBlockType type: {eBlockType::RESIDUAL, eBlockType::BOTTLENECK, eBlockType::DEPTHWISE, eBlockType::DEPTHWISE_SE})
+    {
+        Network net(3, 6, 7, 7, 4, 16, 2, 1, type);
+        // a few training passes give the batch norms non-trivial running statistics
+        for (int i = 0; i < 5; i++)
+        {
+            net->forward(torch::rand({8, 3, 6, 7}) * 2);
+        }
+        net->eval();
+
+        torch::Tensor input    = torch::rand({4, 3, 6, 7});
+        auto          expected = net->forward(input);
+        net->fuse();
+        auto fused = net->forward(input);
+        assert(torch::allclose(fused.first, expected.first, 1e-4, 1e-5));
+        assert(torch::allclose(fused.second, expected.second, 1e-4, 1e-5));
+
+        // training drops the folded weights, which would be stale afterwards
+        net->train();
+        net->eval();
+        assert(torch::allclose(net->forward(input).second, expected.second));
+    }
+}
+
+void testNetworkArchitecture()
+{
+    LINFO << "Testing loading a network of another architecture than the settings";
+    std::filesystem::path const path = "test/architecture.pt";
+    std::filesystem::remove(path);
+
+    std::shared_ptr<Settings> small = std::make_shared<Settings>();
+    small->setResidualBlocks(2);
+    small->setFilters(8);
+    small->setBlockType(eBlockType::DEPTHWISE_SE);
+    small->setModelPath(path);
+    NeuralNetwork created(small);
+    assert((created.getNetwork()->getArchitecture() == std::vector<int64_t>{2, 8, 2, 1, 3}));
+
+    // the saved architecture wins over the default settings
+    std::shared_ptr<Settings> defaults = std::make_shared<Settings>();
+    defaults->setModelPath(path);
+    NeuralNetwork loaded(defaults);
+    assert((loaded.getNetwork()->getArchitecture() == std::vector<int64_t>{2, 8, 2, 1, 3}));
+    assert(loaded.getChecksum() == created.getChecksum());
+}
+
+void testLoadIntoFusedNetwork()
+{
+    LINFO << "Testing loading other weights into a network with folded batch norms";
+    torch::NoGradGuard          noGrad;
+    std::filesystem::path const firstPath  = "test/first.pt";
+    std::filesystem::path const secondPath = "test/second.pt";
+    std::filesystem::remove(firstPath);
+    std::filesystem::remove(secondPath);
+
+    std::shared_ptr<Settings> settings = std::make_shared<Settings>();
+    settings->setResidualBlocks(2);
+    settings->setFilters(8);
+    settings->setModelPath(secondPath);
+    NeuralNetwork second(settings);
+    settings->setModelPath(firstPath);
+    NeuralNetwork net(settings);
+
+    torch::Tensor input  = torch::rand({4, 3, 6, 7});
+    torch::Tensor before = net.predict(input).second;
+    torch::Tensor target = second.predict(input).second;
+    assert(!torch::allclose(before, target));
+
+    // the folded copies of the first weights must not outlive the load
+    assert(net.loadModel(secondPath));
+    assert(torch::allclose(net.predict(input).second, target, 1e-4, 1e-5));
+    assert(net.getChecksum() == second.getChecksum());
+}
+
+void testScriptedModel()
+{
+    LINFO << "Testing the exported scripted model against the eager network";
+    torch::NoGradGuard          noGrad;
+    std::filesystem::path const modelPath  = "test/eager.pt";
+    std::filesystem::path const scriptPath = "test/scripted.pt";
+    std::filesystem::remove(modelPath);
+
+    std::shared_ptr<Settings> settings = std::make_shared<Settings>();
+    settings->setResidualBlocks(2);
+    settings->setFilters(8);
+    settings->setModelPath(modelPath);
+    NeuralNetwork eager(settings);
+    eager.exportScriptedModel(scriptPath);
+
+    settings->setScriptedModelPath(scriptPath);
+    NeuralNetwork scripted(settings);
+    assert(scripted.isScripted());
+    // the small network of a two-tier search keeps its own weights
+    assert(!NeuralNetwork(settings, modelPath, 8).isScripted());
+
+    // the script is a second copy of the forward pass, which must not drift from the eager one
+    torch::Tensor input    = torch::rand({4, 3, 6, 7});
+    auto          expected = eager.predict(input);
+    auto          actual   = scripted.predict(input);
+    assert(torch::allclose(actual.first, expected.first, 1e-4, 1e-5));
+    assert(torch::allclose(actual.second, expected.second, 1e-4, 1e-5));
+}
+
 void testStochasticDistribution()
 {
     LDEBUG << "Testing stochastic distribution...";
@@ -190,6 +640,22 @@ void runTests() {
     Test::testVerticalWin();
     Test::testDiagonalWin();
     Test::testEasyPuzzle();
+    Test::testSolver();
+    Test::testAvoidProvenLoss();
+    Test::testTreeSnapshot();
+    Test::testReuseUnvisitedChild();
+    Test::testAdaptiveSimulationsOnReusedRoot();
+    Test::testBatchedSearchVisits();
+    Test::testOpeningTree();
+    Test::testSearchCache();
+    Test::testEvaluationStore();
+    Test::testEdgeStats();
+    Test::testNodeMemory();
+    Test::testNodeStorage();
+    Test::testConvBatchNormFusion();
+    Test::testNetworkArchitecture();
+    Test::testLoadIntoFusedNetwork();
+    Test::testScriptedModel();
     Test::testStochasticDistribution();
     Test::testReadAndWriteMemoryElement();
 }
@@ -16,6 +16,38 @@ void testDiagonalWin();
 
 void testEasyPuzzle();
 
+void testSolver();
+
+void testAvoidProvenLoss();
+
+void testTreeSnapshot();
+
+void testReuseUnvisitedChild();
+
+void testAdaptiveSimulationsOnReusedRoot();
+
+void testBatchedSearchVisits();
+
+void testOpeningTree();
+
+void testSearchCache();
+
+void testEvaluationStore();
+
+void testEdgeStats();
+
+void testNodeMemory();
+
+void testNodeStorage();
+
+void testConvBatchNormFusion();
+
+void testNetworkArchitecture();
+
+void testLoadIntoFusedNetwork();
+
+void testScriptedModel();
+
 void testStochasticDistribution();
 
 void testReadAndWriteMemoryElement();
@@ -18,6 +18,7 @@ struct MemoryElement
         currentPlayer = other.currentPlayer;
         winner        = other.winner;
         moveList      = other.moveList;
+        fullSearch    = other.fullSearch;
     };
     ~MemoryElement() {}
 
@@ -25,6 +26,9 @@ struct MemoryElement
     uint8_t              currentPlayer;
     std::vector<float>   moveList;
     int8_t               winner;
+    // true if the move got the full search budget and its moveList can be used as a policy target.
+    // Only these elements are written to file.
+    bool                 fullSearch = true;
 };
 
 /**
@@ -56,6 +60,27 @@ struct LossHistory
     std::vector<float> policies    = std::vector<float>();
 };
 
+/**
+ * @brief Size and shape of an MCTS tree, used to size node budgets.
+ *
+ */
+struct TreeStatistics
+{
+    ~TreeStatistics() {}
+
+    int              nodes           = 0;
+    int              expandedNodes   = 0;
+    int              maxDepth        = 0;
+    float            branchingFactor = 0.0f;
+    size_t           bytesUsed       = 0;
+    size_t           storedBytes     = 0; // part of bytesUsed in the node storage file instead of on the heap
+    float            reusedFraction  = 0.0f; // only measured when logging tree statistics
+    int              freeNodes       = 0;
+    int              fullEvaluations  = 0; // leaves evaluated by the full network
+    int              smallEvaluations = 0; // leaves evaluated by the small network
+    std::vector<int> depthHistogram  = std::vector<int>();
+};
+
 /**
  * @brief Tally for counting wins when self-playing.
  *
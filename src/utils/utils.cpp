@@ -2,6 +2,8 @@
 
 #include <Python.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
@@ -191,13 +193,15 @@ void createLossGraph(std::string filename, LossHistory & lossHistory)
     (void)lossHistory;
 }
 
-std::vector<float> sampleFromGamma(int size)
+std::vector<float> sampleFromGamma(int size, std::default_random_engine & generator)
 {
-    std::vector<float> samples = std::vector<float>(size, 0.0f);
-    float              sum     = 0.0f;
+    // a copy of the distribution, so different searches can sample in parallel
+    std::gamma_distribution<double> gammaDist(g_GammaDist.param());
+    std::vector<float>              samples = std::vector<float>(size, 0.0f);
+    float                           sum     = 0.0f;
     for (int i = 0; i < size; i++)
     {
-        samples[i] = g_GammaDist(g_Generator);
+        samples[i] = gammaDist(generator);
         sum += samples[i];
     }
     for (int i = 0; i < size; i++)
@@ -207,20 +211,33 @@ std::vector<float> sampleFromGamma(int size)
     return samples;
 }
 
-std::vector<float> calculateDirichletNoise(torch::Tensor const & root_priors)
+std::vector<float> calculateDirichletNoise(std::vector<float> const & root_priors, std::default_random_engine & generator)
 {
     std::vector<float> dirichletNoiseVector;
 
     // get the noise
-    std::vector<float> noise = sampleFromGamma(root_priors.size(0));
+    std::vector<float> noise = sampleFromGamma(root_priors.size(), generator);
 
     float frac = 0.25;
     for (int i = 0; i < (int)noise.size(); i++)
     {
-        dirichletNoiseVector.emplace_back(root_priors[i].item<float>() * (1 - frac) + noise[i] * frac);
+        dirichletNoiseVector.emplace_back(root_priors[i] * (1 - frac) + noise[i] * frac);
     }
 
     return dirichletNoiseVector;
 }
 
+float klDivergence(std::vector<float> const & p, std::vector<float> const & q)
+{
+    float const epsilon    = 1e-6f;
+    float       divergence = 0.0f;
+    for (int i = 0; i < (int)p.size(); i++)
+    {
+        float pi = p[i] + epsilon;
+        float qi = q[i] + epsilon;
+        divergence += pi * std::log(pi / qi);
+    }
+    return std::max(divergence, 0.0f);
+}
+
 } // namespace utils
@@ -63,8 +63,32 @@ void writeLossToCSV(std::string filename, LossHistory& lossHistory);
 
 void createLossGraph(std::string filename, LossHistory& lossHistory);
 
-std::vector<float> sampleFromGamma(int size);
+/**
+ * @brief Draw normalized samples from the gamma distribution
+ *
+ * @param size: the amount of samples
+ * @param generator: the random engine to draw with
+ * @return std::vector<float>: samples that sum to 1
+ */
+std::vector<float> sampleFromGamma(int size, std::default_random_engine & generator);
+
+/**
+ * @brief Mix dirichlet noise into the given priors
+ *
+ * @param root_priors: the priors of the root's children
+ * @param generator: the random engine to draw the noise with
+ * @return std::vector<float>: the priors with noise
+ */
+std::vector<float> calculateDirichletNoise(std::vector<float> const & root_priors, std::default_random_engine & generator);
 
-std::vector<float> calculateDirichletNoise(torch::Tensor const & root_priors);
+/**
+ * @brief Calculate the KL divergence KL(p || q) of two discrete distributions.
+ * Both are smoothed slightly, so zero probabilities don't cause infinities.
+ *
+ * @param p: the new distribution
+ * @param q: the reference distribution, of the same size
+ * @return float: the divergence, 0 for identical distributions
+ */
+float klDivergence(std::vector<float> const & p, std::vector<float> const & q);
 
 } // namespace utils
\ No newline at end of file